@@ -0,0 +1,367 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARENA_X86 1
+#include <immintrin.h>
+#endif
+
+#include "arena.h"
+#include "world.h"
+
+/* Everything the kernels need to know about the paddles and the
+ * playfield for the current tick */
+struct bounds{
+        int32_t x_max;
+        int32_t y_max;
+        int32_t p1_x_start;
+        int32_t p1_x_end;
+        int32_t p1_y_start;
+        int32_t p1_y_end;
+        int32_t p2_x_start;
+        int32_t p2_x_end;
+        int32_t p2_y_start;
+        int32_t p2_y_end;
+};
+
+typedef void (*arena_kernel_fn)(struct arena *const arena, struct world *const world, const struct bounds *const B);
+
+static void bounceBall(struct arena *const arena, const unsigned I);
+static uint32_t nextRandom(struct arena *const arena);
+static void resetArenaBall(struct arena *const arena, const unsigned I);
+static void scoreBall(struct arena *const arena, struct world *const world, const unsigned I, const struct bounds *const B);
+static void stepScalar(struct arena *const arena, struct world *const world, const struct bounds *const B);
+static void stepScalarRange(struct arena *const arena, struct world *const world, const struct bounds *const B, const unsigned START, const unsigned END);
+#ifdef ARENA_X86
+static void fixupBalls(struct arena *const arena, struct world *const world, const struct bounds *const B, const unsigned BASE, unsigned fixups, const unsigned SCORES);
+static void stepAVX2(struct arena *const arena, struct world *const world, const struct bounds *const B);
+static void stepSSE41(struct arena *const arena, struct world *const world, const struct bounds *const B);
+#endif
+
+const char *const ARENA_KERNEL_NAMES[ARENA_KERNELS] = {
+        [ARENA_SCALAR] = "scalar",
+        [ARENA_SSE41] = "sse4.1",
+        [ARENA_AVX2] = "avx2"
+};
+
+enum arena_kernel bestArenaKernel(void){
+#ifdef ARENA_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")){
+                return ARENA_AVX2;
+        }
+        if(__builtin_cpu_supports("sse4.1")){
+                return ARENA_SSE41;
+        }
+#endif
+        return ARENA_SCALAR;
+}
+
+void freeArena(struct arena *const arena){
+        free(arena->x);
+        arena->x = NULL;
+        arena->count = 0;
+}
+
+unsigned initArena(struct arena *const arena, const unsigned COUNT, const struct character *const ball, const uint64_t SEED){
+        arena->x = malloc(4*sizeof(*arena->x)*COUNT);
+        if(!arena->x){
+                fprintf(stderr, "*** Error: Unable to allocate %u balls\n", COUNT);
+                return 1;
+        }
+        arena->y = arena->x + COUNT;
+        arena->x_vel = arena->y + COUNT;
+        arena->y_vel = arena->x_vel + COUNT;
+
+        arena->count = COUNT;
+        arena->w = ball->box.w;
+        arena->h = ball->box.h;
+        arena->rng = SEED;
+
+        /* Serve alternately to either side so play is spread across the
+         * field */
+        for(unsigned i = 0; i < COUNT; i++){
+                arena->x_vel[i] = (i % 2) ? -ball->x_vel : ball->x_vel;
+                resetArenaBall(arena, i);
+        }
+
+        return 0;
+}
+
+unsigned stepArena(struct arena *const arena, struct world *const world, const enum arena_kernel KERNEL){
+        static const arena_kernel_fn KERNELS[ARENA_KERNELS] = {
+                [ARENA_SCALAR] = stepScalar,
+#ifdef ARENA_X86
+                [ARENA_SSE41] = stepSSE41,
+                [ARENA_AVX2] = stepAVX2
+#endif
+        };
+        if(!KERNELS[KERNEL]){
+                fprintf(stderr, "*** Error: The %s kernel is not available on this platform\n", ARENA_KERNEL_NAMES[KERNEL]);
+                return 1;
+        }
+
+        const struct box *const PLAYER1 = &world->player1.avatar.box;
+        const struct box *const PLAYER2 = &world->player2.avatar.box;
+        const struct bounds B = {
+                .x_max = WIDTH - arena->w,
+                .y_max = HEIGHT - arena->h,
+                .p1_x_start = PLAYER1->x,
+                .p1_x_end = PLAYER1->x + (PLAYER1->w-1),
+                .p1_y_start = PLAYER1->y,
+                .p1_y_end = PLAYER1->y + (PLAYER1->h-1),
+                .p2_x_start = PLAYER2->x,
+                .p2_x_end = PLAYER2->x + (PLAYER2->w-1),
+                .p2_y_start = PLAYER2->y,
+                .p2_y_end = PLAYER2->y + (PLAYER2->h-1)
+        };
+        KERNELS[KERNEL](arena, world, &B);
+
+        return 0;
+}
+
+/* Same as paddleBounce() in world.c, from the arena's own generator */
+static void bounceBall(struct arena *const arena, const unsigned I){
+        arena->y_vel[I] = nextRandom(arena) % 6;
+        arena->y_vel[I] *= (nextRandom(arena) % 2) ? -1 : 1;
+}
+
+static uint32_t nextRandom(struct arena *const arena){
+        return mixRandom(&arena->rng) >> 32;
+}
+
+static void resetArenaBall(struct arena *const arena, const unsigned I){
+        arena->x[I] = (WIDTH - arena->w)/2;
+        arena->y[I] = nextRandom(arena) % (HEIGHT - arena->h);
+        bounceBall(arena, I);
+}
+
+static void scoreBall(struct arena *const arena, struct world *const world, const unsigned I, const struct bounds *const B){
+        if(arena->x[I] == 0){
+                world->player2.score++;
+        }else if(arena->x[I] == B->x_max){
+                world->player1.score++;
+        }
+        resetArenaBall(arena, I);
+}
+
+static void stepScalar(struct arena *const arena, struct world *const world, const struct bounds *const B){
+        stepScalarRange(arena, world, B, 0, arena->count);
+}
+
+/* Each ball is only tested where it ends the tick, in this order of
+ * precedence: scoring, then paddle 1, then paddle 2, then the walls.
+ * Unlike stepWorld(), which sweeps the ball's path, this keeps every
+ * lane of the vector kernels to the same few comparisons; arena balls
+ * move slowly enough not to pass through a paddle. */
+static void stepScalarRange(struct arena *const arena, struct world *const world, const struct bounds *const B, const unsigned START, const unsigned END){
+        for(unsigned i = START; i < END; i++){
+                int32_t x = arena->x[i] + arena->x_vel[i];
+                int32_t y = arena->y[i] + arena->y_vel[i];
+                x = (x < 0) ? 0 : ((x > B->x_max) ? B->x_max : x);
+                y = (y < 0) ? 0 : ((y > B->y_max) ? B->y_max : y);
+                arena->x[i] = x;
+                arena->y[i] = y;
+
+                const int32_t X_END = x + (arena->w-1);
+                const int32_t Y_END = y + (arena->h-1);
+
+                if(x == 0 || x == B->x_max){
+                        scoreBall(arena, world, i, B);
+                }else if((x >= B->p1_x_start && x <= B->p1_x_end) || (X_END >= B->p1_x_start && X_END <= B->p1_x_end)){
+                        if((y >= B->p1_y_start && y <= B->p1_y_end) || (Y_END >= B->p1_y_start && Y_END <= B->p1_y_end)){
+                                arena->x[i] = B->p1_x_end + 1;
+                                arena->x_vel[i] *= -1;
+                                bounceBall(arena, i);
+                        }
+                }else if((x >= B->p2_x_start && x <= B->p2_x_end) || (X_END >= B->p2_x_start && X_END <= B->p2_x_end)){
+                        if((y >= B->p2_y_start && y <= B->p2_y_end) || (Y_END >= B->p2_y_start && Y_END <= B->p2_y_end)){
+                                arena->x[i] = B->p2_x_start - arena->w;
+                                arena->x_vel[i] *= -1;
+                                bounceBall(arena, i);
+                        }
+                }else if(y == 0 || y == B->y_max){
+                        arena->y_vel[i] *= -1;
+                }
+        }
+}
+
+#ifdef ARENA_X86
+/* Scoring and paddle bounces draw random numbers, so the vector kernels
+ * leave them to this scalar pass. Lanes are visited in index order to
+ * consume the generator exactly as stepScalar() does. */
+static void fixupBalls(struct arena *const arena, struct world *const world, const struct bounds *const B, const unsigned BASE, unsigned fixups, const unsigned SCORES){
+        while(fixups){
+                const unsigned LANE = __builtin_ctz(fixups);
+                fixups &= fixups - 1;
+
+                if(SCORES & (1u << LANE)){
+                        scoreBall(arena, world, BASE + LANE, B);
+                }else{
+                        bounceBall(arena, BASE + LANE);
+                }
+        }
+}
+
+/* Lanes where LO <= V <= HI */
+__attribute__((target("avx2")))
+static inline __m256i inRangeAVX2(const __m256i V, const __m256i LO, const __m256i HI){
+        return _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(LO, V), _mm256_cmpgt_epi32(V, HI)), _mm256_set1_epi32(-1));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i inRangeSSE41(const __m128i V, const __m128i LO, const __m128i HI){
+        return _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(LO, V), _mm_cmpgt_epi32(V, HI)), _mm_set1_epi32(-1));
+}
+
+__attribute__((target("avx2")))
+static void stepAVX2(struct arena *const arena, struct world *const world, const struct bounds *const B){
+        const __m256i ZERO = _mm256_setzero_si256();
+        const __m256i X_MAX = _mm256_set1_epi32(B->x_max);
+        const __m256i Y_MAX = _mm256_set1_epi32(B->y_max);
+        const __m256i W_1 = _mm256_set1_epi32(arena->w - 1);
+        const __m256i H_1 = _mm256_set1_epi32(arena->h - 1);
+        const __m256i P1_XS = _mm256_set1_epi32(B->p1_x_start);
+        const __m256i P1_XE = _mm256_set1_epi32(B->p1_x_end);
+        const __m256i P1_YS = _mm256_set1_epi32(B->p1_y_start);
+        const __m256i P1_YE = _mm256_set1_epi32(B->p1_y_end);
+        const __m256i P2_XS = _mm256_set1_epi32(B->p2_x_start);
+        const __m256i P2_XE = _mm256_set1_epi32(B->p2_x_end);
+        const __m256i P2_YS = _mm256_set1_epi32(B->p2_y_start);
+        const __m256i P2_YE = _mm256_set1_epi32(B->p2_y_end);
+        const __m256i P1_BOUNCE_X = _mm256_set1_epi32(B->p1_x_end + 1);
+        const __m256i P2_BOUNCE_X = _mm256_set1_epi32(B->p2_x_start - arena->w);
+
+        const unsigned COUNT = arena->count & ~7u;
+        for(unsigned i = 0; i < COUNT; i += 8){
+                __m256i x = _mm256_loadu_si256((const __m256i *)&arena->x[i]);
+                __m256i y = _mm256_loadu_si256((const __m256i *)&arena->y[i]);
+                __m256i x_vel = _mm256_loadu_si256((const __m256i *)&arena->x_vel[i]);
+                __m256i y_vel = _mm256_loadu_si256((const __m256i *)&arena->y_vel[i]);
+
+                x = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(x, x_vel), ZERO), X_MAX);
+                y = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y, y_vel), ZERO), Y_MAX);
+                const __m256i X_END = _mm256_add_epi32(x, W_1);
+                const __m256i Y_END = _mm256_add_epi32(y, H_1);
+
+                const __m256i SCORE = _mm256_or_si256(_mm256_cmpeq_epi32(x, ZERO), _mm256_cmpeq_epi32(x, X_MAX));
+                const __m256i IN_X1 = _mm256_or_si256(inRangeAVX2(x, P1_XS, P1_XE), inRangeAVX2(X_END, P1_XS, P1_XE));
+                const __m256i IN_Y1 = _mm256_or_si256(inRangeAVX2(y, P1_YS, P1_YE), inRangeAVX2(Y_END, P1_YS, P1_YE));
+                const __m256i IN_X2 = _mm256_or_si256(inRangeAVX2(x, P2_XS, P2_XE), inRangeAVX2(X_END, P2_XS, P2_XE));
+                const __m256i IN_Y2 = _mm256_or_si256(inRangeAVX2(y, P2_YS, P2_YE), inRangeAVX2(Y_END, P2_YS, P2_YE));
+                const __m256i AT_WALL = _mm256_or_si256(_mm256_cmpeq_epi32(y, ZERO), _mm256_cmpeq_epi32(y, Y_MAX));
+
+                const __m256i HIT1 = _mm256_andnot_si256(SCORE, _mm256_and_si256(IN_X1, IN_Y1));
+                const __m256i HIT2 = _mm256_andnot_si256(_mm256_or_si256(SCORE, IN_X1), _mm256_and_si256(IN_X2, IN_Y2));
+                const __m256i WALL = _mm256_andnot_si256(_mm256_or_si256(SCORE, _mm256_or_si256(IN_X1, IN_X2)), AT_WALL);
+                const __m256i HIT = _mm256_or_si256(HIT1, HIT2);
+
+                x = _mm256_blendv_epi8(x, P1_BOUNCE_X, HIT1);
+                x = _mm256_blendv_epi8(x, P2_BOUNCE_X, HIT2);
+                x_vel = _mm256_blendv_epi8(x_vel, _mm256_sub_epi32(ZERO, x_vel), HIT);
+                y_vel = _mm256_blendv_epi8(y_vel, _mm256_sub_epi32(ZERO, y_vel), WALL);
+
+                _mm256_storeu_si256((__m256i *)&arena->x[i], x);
+                _mm256_storeu_si256((__m256i *)&arena->y[i], y);
+                _mm256_storeu_si256((__m256i *)&arena->x_vel[i], x_vel);
+                _mm256_storeu_si256((__m256i *)&arena->y_vel[i], y_vel);
+
+                const unsigned SCORES = _mm256_movemask_ps(_mm256_castsi256_ps(SCORE));
+                const unsigned FIXUPS = SCORES | _mm256_movemask_ps(_mm256_castsi256_ps(HIT));
+                if(FIXUPS){
+                        fixupBalls(arena, world, B, i, FIXUPS, SCORES);
+                }
+        }
+
+        stepScalarRange(arena, world, B, COUNT, arena->count);
+}
+
+__attribute__((target("sse4.1")))
+static void stepSSE41(struct arena *const arena, struct world *const world, const struct bounds *const B){
+        const __m128i ZERO = _mm_setzero_si128();
+        const __m128i X_MAX = _mm_set1_epi32(B->x_max);
+        const __m128i Y_MAX = _mm_set1_epi32(B->y_max);
+        const __m128i W_1 = _mm_set1_epi32(arena->w - 1);
+        const __m128i H_1 = _mm_set1_epi32(arena->h - 1);
+        const __m128i P1_XS = _mm_set1_epi32(B->p1_x_start);
+        const __m128i P1_XE = _mm_set1_epi32(B->p1_x_end);
+        const __m128i P1_YS = _mm_set1_epi32(B->p1_y_start);
+        const __m128i P1_YE = _mm_set1_epi32(B->p1_y_end);
+        const __m128i P2_XS = _mm_set1_epi32(B->p2_x_start);
+        const __m128i P2_XE = _mm_set1_epi32(B->p2_x_end);
+        const __m128i P2_YS = _mm_set1_epi32(B->p2_y_start);
+        const __m128i P2_YE = _mm_set1_epi32(B->p2_y_end);
+        const __m128i P1_BOUNCE_X = _mm_set1_epi32(B->p1_x_end + 1);
+        const __m128i P2_BOUNCE_X = _mm_set1_epi32(B->p2_x_start - arena->w);
+
+        const unsigned COUNT = arena->count & ~3u;
+        for(unsigned i = 0; i < COUNT; i += 4){
+                __m128i x = _mm_loadu_si128((const __m128i *)&arena->x[i]);
+                __m128i y = _mm_loadu_si128((const __m128i *)&arena->y[i]);
+                __m128i x_vel = _mm_loadu_si128((const __m128i *)&arena->x_vel[i]);
+                __m128i y_vel = _mm_loadu_si128((const __m128i *)&arena->y_vel[i]);
+
+                x = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(x, x_vel), ZERO), X_MAX);
+                y = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(y, y_vel), ZERO), Y_MAX);
+                const __m128i X_END = _mm_add_epi32(x, W_1);
+                const __m128i Y_END = _mm_add_epi32(y, H_1);
+
+                const __m128i SCORE = _mm_or_si128(_mm_cmpeq_epi32(x, ZERO), _mm_cmpeq_epi32(x, X_MAX));
+                const __m128i IN_X1 = _mm_or_si128(inRangeSSE41(x, P1_XS, P1_XE), inRangeSSE41(X_END, P1_XS, P1_XE));
+                const __m128i IN_Y1 = _mm_or_si128(inRangeSSE41(y, P1_YS, P1_YE), inRangeSSE41(Y_END, P1_YS, P1_YE));
+                const __m128i IN_X2 = _mm_or_si128(inRangeSSE41(x, P2_XS, P2_XE), inRangeSSE41(X_END, P2_XS, P2_XE));
+                const __m128i IN_Y2 = _mm_or_si128(inRangeSSE41(y, P2_YS, P2_YE), inRangeSSE41(Y_END, P2_YS, P2_YE));
+                const __m128i AT_WALL = _mm_or_si128(_mm_cmpeq_epi32(y, ZERO), _mm_cmpeq_epi32(y, Y_MAX));
+
+                const __m128i HIT1 = _mm_andnot_si128(SCORE, _mm_and_si128(IN_X1, IN_Y1));
+                const __m128i HIT2 = _mm_andnot_si128(_mm_or_si128(SCORE, IN_X1), _mm_and_si128(IN_X2, IN_Y2));
+                const __m128i WALL = _mm_andnot_si128(_mm_or_si128(SCORE, _mm_or_si128(IN_X1, IN_X2)), AT_WALL);
+                const __m128i HIT = _mm_or_si128(HIT1, HIT2);
+
+                x = _mm_blendv_epi8(x, P1_BOUNCE_X, HIT1);
+                x = _mm_blendv_epi8(x, P2_BOUNCE_X, HIT2);
+                x_vel = _mm_blendv_epi8(x_vel, _mm_sub_epi32(ZERO, x_vel), HIT);
+                y_vel = _mm_blendv_epi8(y_vel, _mm_sub_epi32(ZERO, y_vel), WALL);
+
+                _mm_storeu_si128((__m128i *)&arena->x[i], x);
+                _mm_storeu_si128((__m128i *)&arena->y[i], y);
+                _mm_storeu_si128((__m128i *)&arena->x_vel[i], x_vel);
+                _mm_storeu_si128((__m128i *)&arena->y_vel[i], y_vel);
+
+                const unsigned SCORES = _mm_movemask_ps(_mm_castsi128_ps(SCORE));
+                const unsigned FIXUPS = SCORES | _mm_movemask_ps(_mm_castsi128_ps(HIT));
+                if(FIXUPS){
+                        fixupBalls(arena, world, B, i, FIXUPS, SCORES);
+                }
+        }
+
+        stepScalarRange(arena, world, B, COUNT, arena->count);
+}
+#endif
@@ -0,0 +1,63 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+
+#include "world.h"
+
+enum arena_kernel{
+        ARENA_SCALAR,
+        ARENA_SSE41,
+        ARENA_AVX2,
+        ARENA_KERNELS
+};
+
+/* Multi-ball mode: the balls are stored as separate position and
+ * velocity arrays so that the kernels may step many of them at once.
+ * Every ball shares the dimensions of the world's ball. */
+struct arena{
+        unsigned count;
+        int w;
+        int h;
+        int32_t *x;
+        int32_t *y;
+        int32_t *x_vel;
+        int32_t *y_vel;
+        uint64_t rng;
+};
+
+extern const char *const ARENA_KERNEL_NAMES[ARENA_KERNELS];
+
+enum arena_kernel bestArenaKernel(void);
+void freeArena(struct arena *const arena);
+unsigned initArena(struct arena *const arena, const unsigned COUNT, const struct character *const ball, const uint64_t SEED);
+unsigned stepArena(struct arena *const arena, struct world *const world, const enum arena_kernel KERNEL);
+
+#endif
@@ -0,0 +1,216 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_ttf.h"
+
+#include "atlas.h"
+#include "pool.h"
+#include "world.h"
+
+#define SCORE_FONT_SIZE 32
+#define HUD_FONT_SIZE 12
+
+/* One job per image, plus one for the score digits and one for the
+ * glyphs of the timing overlay */
+#define LOAD_DIGITS_JOB ATLAS_DIGIT0
+#define LOAD_GLYPHS_JOB (ATLAS_DIGIT0 + 1)
+#define LOAD_JOBS (ATLAS_DIGIT0 + 2)
+
+/* Each job writes only its own surfaces, and each font is only used by
+ * the one job that renders from it */
+struct load{
+        const char *media_dir;
+        TTF_Font *score_font;
+        TTF_Font *hud_font;
+        SDL_Surface **surfaces;
+        unsigned failed;
+};
+
+static void loadEntry(void *const context, const unsigned INDEX);
+static unsigned renderGlyphs(TTF_Font *const font, const Uint16 FIRST, const unsigned COUNT, SDL_Surface *glyphs[]);
+
+/* The PNGs are decoded and the glyphs rasterized in parallel, the fonts
+ * having been opened beforehand, as FreeType faces may only be created
+ * one at a time. On failure any surfaces already loaded are left in the
+ * array for the caller to free. */
+unsigned loadAtlasSurfaces(const char *const MEDIA_DIR, SDL_Surface *surfaces[ATLAS_ENTRIES]){
+        struct load load = { .media_dir = MEDIA_DIR, .surfaces = surfaces };
+        char path[4096];
+
+        if(TTF_Init()){
+                fprintf(stderr, "*** Error: Unable to initialize TrueType font support: %s\n", TTF_GetError());
+                return 1;
+        }
+
+        snprintf(path, sizeof(path), "%s/fonts/boingium.ttf", MEDIA_DIR);
+        load.score_font = TTF_OpenFont(path, SCORE_FONT_SIZE);
+        if(!load.score_font){
+                fprintf(stderr, "*** Error: Unable to open font file \"%s\": %s\n", path, TTF_GetError());
+                goto err_open_score_font;
+        }
+        load.hud_font = TTF_OpenFont(path, HUD_FONT_SIZE);
+        if(!load.hud_font){
+                fprintf(stderr, "*** Error: Unable to open font file \"%s\": %s\n", path, TTF_GetError());
+                goto err_open_hud_font;
+        }
+
+        if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG){
+                fprintf(stderr, "*** Error: Unable to initialize PNG image support: %s\n", IMG_GetError());
+                goto err_img_init;
+        }
+
+        const unsigned PROCESSORS = onlineProcessors();
+        if(runPool(LOAD_JOBS, (PROCESSORS < LOAD_JOBS) ? PROCESSORS : LOAD_JOBS, loadEntry, &load)){
+                goto err_run_pool;
+        }
+        if(load.failed){
+                goto err_load_entry;
+        }
+
+        IMG_Quit();
+        TTF_CloseFont(load.hud_font);
+        TTF_CloseFont(load.score_font);
+        TTF_Quit();
+        return 0;
+
+err_load_entry:
+err_run_pool:
+        IMG_Quit();
+err_img_init:
+        TTF_CloseFont(load.hud_font);
+err_open_hud_font:
+        TTF_CloseFont(load.score_font);
+err_open_score_font:
+        TTF_Quit();
+        return 1;
+}
+
+/* Sprites are packed left to right into shelves as wide as the widest
+ * sprite; ATLAS_PADDING transparent pixels separate neighbours so that
+ * linear filtering does not bleed one sprite into the next */
+SDL_Surface *packAtlas(SDL_Surface *const surfaces[ATLAS_ENTRIES], struct atlas *const atlas){
+        atlas->w = 0;
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_Rect *const rect = &atlas->rects[i];
+                rect->w = (surfaces[i]->w > WIDTH) ? WIDTH : surfaces[i]->w;
+                rect->h = (surfaces[i]->h > HEIGHT) ? HEIGHT : surfaces[i]->h;
+                if(rect->w > atlas->w){
+                        atlas->w = rect->w;
+                }
+        }
+
+        int x = 0;
+        int y = 0;
+        int shelf_h = 0;
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_Rect *const rect = &atlas->rects[i];
+                if(x + rect->w > atlas->w){
+                        x = 0;
+                        y += shelf_h + ATLAS_PADDING;
+                        shelf_h = 0;
+                }
+                rect->x = x;
+                rect->y = y;
+                x += rect->w + ATLAS_PADDING;
+                if(rect->h > shelf_h){
+                        shelf_h = rect->h;
+                }
+        }
+        atlas->h = y + shelf_h;
+
+        SDL_Surface *const surface = SDL_CreateRGBSurfaceWithFormat(0, atlas->w, atlas->h, 32, SDL_PIXELFORMAT_ARGB8888);
+        if(!surface){
+                fprintf(stderr, "*** Error: Unable to create atlas surface: %s\n", SDL_GetError());
+                return NULL;
+        }
+
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                const SDL_Rect SRC = { .x = 0, .y = 0, .w = atlas->rects[i].w, .h = atlas->rects[i].h };
+                SDL_Rect dest = atlas->rects[i];
+
+                /* Copy alpha verbatim rather than blending onto the
+                 * transparent atlas; colour keys are still honoured */
+                SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+                if(SDL_BlitSurface(surfaces[i], &SRC, surface, &dest)){
+                        fprintf(stderr, "*** Error: Unable to copy sprite %u into atlas: %s\n", i, SDL_GetError());
+                        goto err_blit_surface;
+                }
+        }
+
+        return surface;
+
+err_blit_surface:
+        SDL_FreeSurface(surface);
+        return NULL;
+}
+
+static void loadEntry(void *const context, const unsigned INDEX){
+        static const char *const IMAGE_FILES[ATLAS_DIGIT0] = {
+                [ATLAS_BACKGROUND] = "images/background.png",
+                [ATLAS_BALL] = "images/ball.png",
+                [ATLAS_PADDLE1] = "images/paddle1.png",
+                [ATLAS_PADDLE2] = "images/paddle2.png"
+        };
+        struct load *const load = context;
+
+        unsigned failed;
+        if(INDEX == LOAD_DIGITS_JOB){
+                failed = renderGlyphs(load->score_font, '0', 10, &load->surfaces[ATLAS_DIGIT0]);
+        }else if(INDEX == LOAD_GLYPHS_JOB){
+                failed = renderGlyphs(load->hud_font, ATLAS_GLYPH_FIRST, ATLAS_GLYPHS, &load->surfaces[ATLAS_GLYPH0]);
+        }else{
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/%s", load->media_dir, IMAGE_FILES[INDEX]);
+                load->surfaces[INDEX] = IMG_Load(path);
+                failed = !load->surfaces[INDEX];
+                if(failed){
+                        fprintf(stderr, "*** Error: Unable to load \"%s\": %s\n", path, IMG_GetError());
+                }
+        }
+
+        if(failed){
+                __atomic_store_n(&load->failed, 1, __ATOMIC_RELAXED);
+        }
+}
+
+static unsigned renderGlyphs(TTF_Font *const font, const Uint16 FIRST, const unsigned COUNT, SDL_Surface *glyphs[]){
+        const SDL_Color COLOR = { .r = 255, .g = 255, .b = 255 };
+
+        for(unsigned i = 0; i < COUNT; i++){
+                glyphs[i] = TTF_RenderGlyph_Solid(font, FIRST + i, COLOR);
+                if(!glyphs[i]){
+                        fprintf(stderr, "*** Error: Unable to render glyph '%c': %s\n", FIRST + i, TTF_GetError());
+                        return 1;
+                }
+        }
+
+        return 0;
+}
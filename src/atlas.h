@@ -0,0 +1,57 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "SDL.h"
+
+#define ATLAS_PADDING 1
+#define ATLAS_GLYPH_FIRST ' '
+#define ATLAS_GLYPHS ('~' - ' ' + 1)
+
+enum atlas_entry{
+        ATLAS_BACKGROUND,
+        ATLAS_BALL,
+        ATLAS_PADDLE1,
+        ATLAS_PADDLE2,
+        ATLAS_DIGIT0,
+        ATLAS_GLYPH0 = ATLAS_DIGIT0 + 10,
+        ATLAS_ENTRIES = ATLAS_GLYPH0 + ATLAS_GLYPHS
+};
+
+/* Location of every sprite within the single atlas texture */
+struct atlas{
+        SDL_Rect rects[ATLAS_ENTRIES];
+        int w;
+        int h;
+};
+
+unsigned loadAtlasSurfaces(const char *const MEDIA_DIR, SDL_Surface *surfaces[ATLAS_ENTRIES]);
+SDL_Surface *packAtlas(SDL_Surface *const surfaces[ATLAS_ENTRIES], struct atlas *const atlas);
+
+#endif
@@ -0,0 +1,103 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "SDL.h"
+
+#include "batch.h"
+
+unsigned addQuad(struct batch *const batch, const SDL_Rect *const SRC, const SDL_Rect *const DEST){
+        if(batch->quads == BATCH_QUADS && flushBatch(batch)){
+                return 1;
+        }
+
+        const float U0 = SRC->x*batch->u_scale;
+        const float V0 = SRC->y*batch->v_scale;
+        const float U1 = (SRC->x + SRC->w)*batch->u_scale;
+        const float V1 = (SRC->y + SRC->h)*batch->v_scale;
+        const float X0 = DEST->x;
+        const float Y0 = DEST->y;
+        const float X1 = DEST->x + DEST->w;
+        const float Y1 = DEST->y + DEST->h;
+
+        SDL_Vertex *const vertex = &batch->vertices[4*batch->quads];
+        vertex[0].position = (SDL_FPoint){ X0, Y0 };
+        vertex[0].tex_coord = (SDL_FPoint){ U0, V0 };
+        vertex[1].position = (SDL_FPoint){ X1, Y0 };
+        vertex[1].tex_coord = (SDL_FPoint){ U1, V0 };
+        vertex[2].position = (SDL_FPoint){ X0, Y1 };
+        vertex[2].tex_coord = (SDL_FPoint){ U0, V1 };
+        vertex[3].position = (SDL_FPoint){ X1, Y1 };
+        vertex[3].tex_coord = (SDL_FPoint){ U1, V1 };
+
+        batch->quads++;
+
+        return 0;
+}
+
+unsigned flushBatch(struct batch *const batch){
+        if(!batch->quads){
+                return 0;
+        }
+
+        const int QUADS = batch->quads;
+        batch->quads = 0;
+        batch->draw_calls++;
+        if(SDL_RenderGeometry(batch->renderer, batch->texture, batch->vertices, 4*QUADS, batch->indices, 6*QUADS) < 0){
+                fprintf(stderr, "*** Error: Unable to render geometry: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        return 0;
+}
+
+void initBatch(struct batch *const batch, SDL_Renderer *const renderer, SDL_Texture *const texture, const int TEXTURE_W, const int TEXTURE_H){
+        const SDL_Color WHITE = { .r = 255, .g = 255, .b = 255, .a = 255 };
+
+        batch->renderer = renderer;
+        batch->texture = texture;
+        batch->u_scale = 1.0f/TEXTURE_W;
+        batch->v_scale = 1.0f/TEXTURE_H;
+        batch->quads = 0;
+        batch->draw_calls = 0;
+
+        /* The index pattern and vertex colour never change */
+        for(unsigned i = 0; i < BATCH_QUADS; i++){
+                int *const index = &batch->indices[6*i];
+                index[0] = 4*i;
+                index[1] = 4*i + 1;
+                index[2] = 4*i + 2;
+                index[3] = 4*i + 2;
+                index[4] = 4*i + 1;
+                index[5] = 4*i + 3;
+
+                for(unsigned j = 0; j < 4; j++){
+                        batch->vertices[4*i + j].color = WHITE;
+                }
+        }
+}
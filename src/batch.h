@@ -0,0 +1,52 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "SDL.h"
+
+#define BATCH_QUADS 4096
+
+/* Textured quads from a single texture, accumulated so that they may be
+ * submitted to the renderer in one SDL_RenderGeometry call */
+struct batch{
+        SDL_Renderer *renderer;
+        SDL_Texture *texture;
+        float u_scale;
+        float v_scale;
+        unsigned quads;
+        unsigned long draw_calls;
+        SDL_Vertex vertices[4*BATCH_QUADS];
+        int indices[6*BATCH_QUADS];
+};
+
+unsigned addQuad(struct batch *const batch, const SDL_Rect *const SRC, const SDL_Rect *const DEST);
+unsigned flushBatch(struct batch *const batch);
+void initBatch(struct batch *const batch, SDL_Renderer *const renderer, SDL_Texture *const texture, const int TEXTURE_W, const int TEXTURE_H);
+
+#endif
@@ -0,0 +1,259 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "SDL.h"
+
+#include "atlas.h"
+#include "batch.h"
+#include "benchmark.h"
+#include "canvas.h"
+#include "profile.h"
+#include "render.h"
+#include "world.h"
+
+#define DRAW_SEED 0x5EEDu
+#define GLYPH_WIDTH 12
+#define GLYPH_HEIGHT 20
+#define PROFILE_WARMUP 64
+
+struct frame_bench{
+        struct scene scene;
+        unsigned failed;
+};
+
+struct paint_bench{
+        struct canvas *canvas;
+        const struct world *world;
+        enum canvas_kernel kernel;
+        unsigned redraw;
+};
+
+static unsigned loadAtlas(SDL_Renderer *const renderer, struct atlas *const atlas, SDL_Texture **const texture, struct canvas *const canvas);
+static void benchDrawWorld(void *const context, const unsigned long ITERATIONS);
+static void benchPaintWorld(void *const context, const unsigned long ITERATIONS);
+
+static struct batch batch;
+static struct profile profile;
+
+/* results are folded into this so that no benchmark can be optimized away */
+static volatile unsigned long sink;
+
+/* Full frames are drawn with the software renderer into a window of the
+ * dummy video driver, so that no display or GPU is needed and timings
+ * do not depend on the graphics stack of the machine */
+int main(void){
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+        if(SDL_Init(SDL_INIT_VIDEO)){
+                fprintf(stderr, "*** Error: Unable to initialize SDL: %s\n", SDL_GetError());
+                goto err_init;
+        }
+
+        SDL_Window *const window = SDL_CreateWindow("benchdraw", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WIDTH, HEIGHT, 0);
+        if(!window){
+                fprintf(stderr, "*** Error: Unable to create window: %s\n", SDL_GetError());
+                goto err_window;
+        }
+
+        SDL_Renderer *const renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+        if(!renderer){
+                fprintf(stderr, "*** Error: Unable to create software renderer: %s\n", SDL_GetError());
+                goto err_renderer;
+        }
+
+        struct atlas atlas;
+        SDL_Texture *texture;
+        struct canvas canvas;
+        if(loadAtlas(renderer, &atlas, &texture, &canvas)){
+                fprintf(stderr, "*** Error: Unable to create sprite atlas\n");
+                goto err_atlas;
+        }
+        initBatch(&batch, renderer, texture, atlas.w, atlas.h);
+
+        struct world world = WORLD_INITIALIZER;
+        initWorld(&world, DRAW_SEED);
+        world.player1.score = 7;
+        world.player2.score = 10;
+
+        /* the overlay needs some frames to show */
+        initProfile(&profile);
+        profile.enabled = 1;
+        for(unsigned i = 0; i < PROFILE_WARMUP; i++){
+                startFrame(&profile);
+                for(unsigned j = 0; j < PROFILE_PHASES; j++){
+                        markPhase(&profile, j);
+                }
+                endFrame(&profile);
+        }
+
+        /* the software renderer always supports target textures */
+        struct layer layer;
+        if(initLayer(&layer, renderer)){
+                fprintf(stderr, "*** Error: Unable to create static layer\n");
+                goto err_layer;
+        }
+
+        struct frame_bench plain = { .scene = { .atlas = &atlas, .batch = &batch, .world = &world } };
+        struct frame_bench hud = { .scene = { .atlas = &atlas, .batch = &batch, .world = &world, .profile = &profile } };
+        struct frame_bench cached = { .scene = { .atlas = &atlas, .batch = &batch, .world = &world, .layer = &layer } };
+        struct paint_bench painted = { .canvas = &canvas, .world = &world, .kernel = bestCanvasKernel() };
+        struct paint_bench redrawn[CANVAS_KERNELS];
+        for(unsigned i = 0; i < CANVAS_KERNELS; i++){
+                redrawn[i] = (struct paint_bench){ .canvas = &canvas, .world = &world, .kernel = i, .redraw = 1 };
+        }
+        struct benchmark benchmarks[] = {
+                { .name = "drawWorld", .run = benchDrawWorld, .context = &plain, .iterations = 256 },
+                { .name = "drawWorld/hud", .run = benchDrawWorld, .context = &hud, .iterations = 256 },
+                { .name = "drawWorld/layer", .run = benchDrawWorld, .context = &cached, .iterations = 256 },
+                { .name = "paintWorld", .run = benchPaintWorld, .context = &painted, .iterations = 1024 },
+                { .name = "paintWorld/redraw-scalar", .run = benchPaintWorld, .context = &redrawn[CANVAS_SCALAR], .iterations = 64 },
+                { .name = "paintWorld/redraw-sse2", .run = benchPaintWorld, .context = &redrawn[CANVAS_SSE2], .iterations = 256 },
+                { .name = "paintWorld/redraw-avx2", .run = benchPaintWorld, .context = &redrawn[CANVAS_AVX2], .iterations = 256 }
+        };
+        /* kernels the processor lacks are left off the end */
+        const unsigned COUNT = sizeof(benchmarks)/sizeof(*benchmarks) - (CANVAS_KERNELS - 1 - bestCanvasKernel());
+
+        runBenchmarks(benchmarks, COUNT);
+        if(plain.failed || hud.failed || cached.failed){
+                fprintf(stderr, "*** Error: Unable to draw world\n");
+                goto err_draw;
+        }
+
+        const unsigned FAILED = checkBenchmarks(benchmarks, COUNT);
+
+        freeLayer(&layer);
+        freeCanvas(&canvas);
+        SDL_DestroyTexture(texture);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+
+        return FAILED;
+
+err_draw:
+        freeLayer(&layer);
+err_layer:
+        freeCanvas(&canvas);
+        SDL_DestroyTexture(texture);
+err_atlas:
+        SDL_DestroyRenderer(renderer);
+err_renderer:
+        SDL_DestroyWindow(window);
+err_window:
+        SDL_Quit();
+err_init:
+        return 1;
+}
+
+static void benchDrawWorld(void *const context, const unsigned long ITERATIONS){
+        struct frame_bench *const bench = context;
+        SDL_Renderer *const renderer = bench->scene.batch->renderer;
+
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                if(drawWorld(renderer, &bench->scene)){
+                        bench->failed = 1;
+                        return;
+                }
+                SDL_RenderPresent(renderer);
+        }
+
+        sink += bench->scene.batch->draw_calls;
+}
+
+static void benchPaintWorld(void *const context, const unsigned long ITERATIONS){
+        struct paint_bench *const bench = context;
+        bench->canvas->kernel = bench->kernel;
+
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                bench->canvas->valid = !bench->redraw;
+                paintWorld(bench->canvas, bench->world);
+        }
+
+        sink += bench->canvas->pixels[WIDTH*HEIGHT/2];
+}
+
+/* The media directory is not needed: the sprites are replaced by solid
+ * blocks of their usual sizes, which cost the renderer the same */
+static unsigned loadAtlas(SDL_Renderer *const renderer, struct atlas *const atlas, SDL_Texture **const texture, struct canvas *const canvas){
+        SDL_Surface *surfaces[ATLAS_ENTRIES] = { NULL };
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                int w = GLYPH_WIDTH;
+                int h = GLYPH_HEIGHT;
+                switch(i){
+                        case ATLAS_BACKGROUND:
+                                w = WIDTH;
+                                h = HEIGHT;
+                                break;
+                        case ATLAS_BALL:
+                                w = BALL_WIDTH;
+                                h = BALL_HEIGHT;
+                                break;
+                        case ATLAS_PADDLE1:
+                        case ATLAS_PADDLE2:
+                                w = PADDLE_WIDTH;
+                                h = PADDLE_HEIGHT;
+                                break;
+                }
+
+                surfaces[i] = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+                if(!surfaces[i] || SDL_FillRect(surfaces[i], NULL, 0xFF000000u | (i*0x9E3779u & 0xFFFFFFu))){
+                        fprintf(stderr, "*** Error: Unable to create sprite %u: %s\n", i, SDL_GetError());
+                        goto err_surfaces;
+                }
+        }
+
+        SDL_Surface *const atlas_surface = packAtlas(surfaces, atlas);
+        if(!atlas_surface){
+                goto err_surfaces;
+        }
+
+        if(initCanvas(canvas, atlas, atlas_surface->pixels, atlas_surface->pitch, bestCanvasKernel())){
+                SDL_FreeSurface(atlas_surface);
+                goto err_surfaces;
+        }
+
+        *texture = SDL_CreateTextureFromSurface(renderer, atlas_surface);
+        SDL_FreeSurface(atlas_surface);
+        if(!*texture){
+                fprintf(stderr, "*** Error: Unable to create texture from sprite atlas: %s\n", SDL_GetError());
+                freeCanvas(canvas);
+                goto err_surfaces;
+        }
+
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+
+        return 0;
+
+err_surfaces:
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+        return 1;
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "benchmark.h"
+
+/* Timings are the fastest of several runs, which is far steadier than
+ * the mean on a machine that is doing anything else */
+#define BENCHMARK_RUNS 7
+#define BENCHMARK_THRESHOLD 25.0
+#define BASELINE_NAME_SIZE 64
+
+static double findBaseline(FILE *const baseline, const char *const NAME, double *const threshold);
+static double nanoseconds(void);
+
+/* Compares each timing against the baseline file named by BENCH_BASELINE
+ * and fails should any be slower by more than BENCH_THRESHOLD percent,
+ * or by more than its own threshold in the baseline where it has one;
+ * benchmarks absent from the baseline are reported but always pass.
+ * Timings are appended to the file named by BENCH_RECORD, if any, so
+ * that a new baseline may be recorded on the reference machine. */
+unsigned checkBenchmarks(const struct benchmark *const BENCHMARKS, const unsigned COUNT){
+        const char *const BASELINE_PATH = getenv("BENCH_BASELINE");
+        const char *const RECORD_PATH = getenv("BENCH_RECORD");
+        const char *const THRESHOLD_STR = getenv("BENCH_THRESHOLD");
+        const double THRESHOLD = (THRESHOLD_STR && *THRESHOLD_STR) ? strtod(THRESHOLD_STR, NULL) : BENCHMARK_THRESHOLD;
+
+        FILE *baseline = NULL;
+        if(BASELINE_PATH && *BASELINE_PATH && !(baseline = fopen(BASELINE_PATH, "r"))){
+                fprintf(stderr, "*** Error: Unable to open baseline %s\n", BASELINE_PATH);
+                return 1;
+        }
+
+        FILE *record = NULL;
+        if(RECORD_PATH && *RECORD_PATH && !(record = fopen(RECORD_PATH, "a"))){
+                fprintf(stderr, "*** Error: Unable to open %s for appending\n", RECORD_PATH);
+                goto err_record;
+        }
+
+        unsigned regressions = 0;
+        printf("%-24s %12s %12s %8s\n", "benchmark", "ns/op", "baseline", "change");
+        for(unsigned i = 0; i < COUNT; i++){
+                double threshold = THRESHOLD;
+                const double BASE = baseline ? findBaseline(baseline, BENCHMARKS[i].name, &threshold) : 0;
+                if(BASE > 0){
+                        const double CHANGE = 100*(BENCHMARKS[i].ns - BASE)/BASE;
+                        const unsigned REGRESSED = CHANGE > threshold;
+                        printf("%-24s %12.1f %12.1f %+7.1f%%%s\n", BENCHMARKS[i].name, BENCHMARKS[i].ns, BASE, CHANGE, REGRESSED ? "  REGRESSION" : "");
+                        regressions += REGRESSED;
+                }else{
+                        printf("%-24s %12.1f %12s %8s\n", BENCHMARKS[i].name, BENCHMARKS[i].ns, "-", "-");
+                }
+
+                if(record){
+                        fprintf(record, "%s %.1f\n", BENCHMARKS[i].name, BENCHMARKS[i].ns);
+                }
+        }
+
+        if(regressions){
+                fprintf(stderr, "*** Error: %u of %u benchmarks slower than baseline by more than their threshold\n", regressions, COUNT);
+        }
+
+        if(record && fclose(record)){
+                fprintf(stderr, "*** Error: Unable to write %s\n", RECORD_PATH);
+                regressions++;
+        }
+        if(baseline){
+                fclose(baseline);
+        }
+
+        return regressions != 0;
+
+err_record:
+        if(baseline){
+                fclose(baseline);
+        }
+        return 1;
+}
+
+void runBenchmarks(struct benchmark *const benchmarks, const unsigned COUNT){
+        for(unsigned i = 0; i < COUNT; i++){
+                /* warm caches and branch predictors before timing */
+                benchmarks[i].run(benchmarks[i].context, benchmarks[i].iterations);
+
+                double best = 0;
+                for(unsigned j = 0; j < BENCHMARK_RUNS; j++){
+                        const double START = nanoseconds();
+                        benchmarks[i].run(benchmarks[i].context, benchmarks[i].iterations);
+                        const double ELAPSED = nanoseconds() - START;
+                        if(!j || ELAPSED < best){
+                                best = ELAPSED;
+                        }
+                }
+                benchmarks[i].ns = best/benchmarks[i].iterations;
+        }
+}
+
+/* Baseline files hold one "name ns/op" pair per line, optionally
+ * followed by a threshold in percent that overrides BENCH_THRESHOLD for
+ * that benchmark; blank lines and lines starting with '#' are ignored,
+ * and later entries win */
+static double findBaseline(FILE *const baseline, const char *const NAME, double *const threshold){
+        rewind(baseline);
+
+        double found = 0;
+        char line[256];
+        while(fgets(line, sizeof(line), baseline)){
+                char name[BASELINE_NAME_SIZE];
+                double ns;
+                double percent;
+                const int FIELDS = (*line == '#') ? 0 : sscanf(line, "%63s %lf %lf", name, &ns, &percent);
+                if(FIELDS < 2){
+                        continue;
+                }
+                if(!strcmp(name, NAME)){
+                        found = ns;
+                        if(FIELDS == 3){
+                                *threshold = percent;
+                        }
+                }
+        }
+
+        return found;
+}
+
+static double nanoseconds(void){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return now.tv_sec*1e9 + now.tv_nsec;
+}
@@ -0,0 +1,224 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "bot.h"
+#include "field.h"
+#include "match.h"
+#include "world.h"
+
+#define CHARACTERS 64
+#define MATCH_SEED 0x5EEDu
+#define MATCH_POINTS 11
+#define FAST_BALL 160
+#define BRICK_PITCH 8
+#define BRICK_SIZE 4
+#define BRICK_SEED 0xB41C4u
+#define SWEEPS 1024
+
+struct characters{
+        struct character characters[CHARACTERS];
+};
+
+/* A square block of bricks at a fixed pitch in the middle of the court,
+ * with sweeps of a ball at the usual speed from points within it; as the
+ * block grows the bricks around each sweep stay the same */
+struct brick_block{
+        struct field field;
+        struct field_sweep sweeps[SWEEPS];
+};
+
+static void benchMoveCharacter(void *const context, const unsigned long ITERATIONS);
+static void benchPlayMatch(void *const context, const unsigned long ITERATIONS);
+static void benchScore(void *const context, const unsigned long ITERATIONS);
+static void benchStepWorld(void *const context, const unsigned long ITERATIONS);
+static void benchSweepField(void *const context, const unsigned long ITERATIONS);
+static unsigned initBrickBlock(struct brick_block *const block, const unsigned SIDE);
+
+/* results are folded into this so that no benchmark can be optimized away */
+static volatile unsigned long sink;
+
+int main(void){
+        struct characters characters;
+        for(unsigned i = 0; i < CHARACTERS; i++){
+                characters.characters[i] = (struct character){
+                        .box = { .x = (i*97) % WIDTH, .y = (i*61) % HEIGHT, .w = BALL_WIDTH, .h = BALL_HEIGHT },
+                        .x_vel = (int)(i % 21) - 10,
+                        .y_vel = (int)(i % 13) - 6
+                };
+        }
+        struct world rally = WORLD_INITIALIZER;
+        initWorld(&rally, MATCH_SEED);
+        struct world score = WORLD_INITIALIZER;
+        initWorld(&score, MATCH_SEED);
+        /* crosses the court in four ticks, far more than a paddle's width */
+        struct world fast = WORLD_INITIALIZER;
+        initWorld(&fast, MATCH_SEED);
+        fast.ball.x_vel = FAST_BALL;
+        static struct brick_block blocks[3];
+        static const unsigned SIDES[] = { 8, 24, 60 };
+        for(unsigned i = 0; i < sizeof(blocks)/sizeof(*blocks); i++){
+                if(initBrickBlock(&blocks[i], SIDES[i])){
+                        fprintf(stderr, "*** Error: Unable to set up block of bricks\n");
+                        return 1;
+                }
+        }
+
+        struct benchmark benchmarks[] = {
+                { .name = "moveCharacter", .run = benchMoveCharacter, .context = &characters, .iterations = 1ul << 24 },
+                { .name = "stepWorld/rally", .run = benchStepWorld, .context = &rally, .iterations = 1ul << 22 },
+                { .name = "stepWorld/score", .run = benchScore, .context = &score, .iterations = 1ul << 20 },
+                { .name = "stepWorld/fast", .run = benchStepWorld, .context = &fast, .iterations = 1ul << 22 },
+                { .name = "sweepField/64", .run = benchSweepField, .context = &blocks[0], .iterations = 1ul << 22 },
+                { .name = "sweepField/576", .run = benchSweepField, .context = &blocks[1], .iterations = 1ul << 22 },
+                { .name = "sweepField/3600", .run = benchSweepField, .context = &blocks[2], .iterations = 1ul << 22 },
+                { .name = "playMatch", .run = benchPlayMatch, .context = NULL, .iterations = 64 },
+                { .name = "playMatch/bot", .run = benchPlayMatch, .context = (void *)(uintptr_t)BOT_LEVELS, .iterations = 64 }
+        };
+        const unsigned COUNT = sizeof(benchmarks)/sizeof(*benchmarks);
+
+        runBenchmarks(benchmarks, COUNT);
+
+        for(unsigned i = 0; i < sizeof(blocks)/sizeof(*blocks); i++){
+                freeField(&blocks[i].field);
+        }
+
+        return checkBenchmarks(benchmarks, COUNT);
+}
+
+static void benchMoveCharacter(void *const context, const unsigned long ITERATIONS){
+        struct characters *const characters = context;
+
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                struct character *const character = &characters->characters[i % CHARACTERS];
+                moveCharacter(character);
+                /* turn around at the walls so that both clamps are taken */
+                if(character->box.x == 0 || character->box.x == WIDTH - character->box.w){
+                        character->x_vel = -character->x_vel;
+                }
+                if(character->box.y == 0 || character->box.y == HEIGHT - character->box.h){
+                        character->y_vel = -character->y_vel;
+                }
+        }
+
+        sink += characters->characters[0].box.x;
+}
+
+/* The context is the bot level, if any, cast to a pointer */
+static void benchPlayMatch(void *const context, const unsigned long ITERATIONS){
+        const unsigned BOT_LEVEL = (uintptr_t)context;
+
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                struct match_result result;
+                playMatch(matchSeed(MATCH_SEED, i), MATCH_POINTS, BOT_LEVEL, &result);
+                sink += result.ticks;
+        }
+}
+
+/* Every tick starts with the ball at the left wall, so each one takes
+ * the scoring path: score update, ball reset and serve */
+static void benchScore(void *const context, const unsigned long ITERATIONS){
+        struct world *const world = context;
+
+        unsigned long events = 0;
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                world->ball.box.x = 0;
+                world->ball.x_vel = -5;
+                events += stepWorld(world);
+        }
+
+        sink += events + world->player2.score;
+}
+
+/* Paddles track the ball as in a headless match, so the ticks are the
+ * usual mix of free flight, wall and paddle bounces, and misses */
+static void benchStepWorld(void *const context, const unsigned long ITERATIONS){
+        struct world *const world = context;
+
+        unsigned long events = 0;
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                trackBall(&world->player1, &world->ball);
+                trackBall(&world->player2, &world->ball);
+                events += stepWorld(world);
+        }
+
+        sink += events;
+}
+
+static void benchSweepField(void *const context, const unsigned long ITERATIONS){
+        const struct brick_block *const BLOCK = context;
+
+        unsigned long hits = 0;
+        for(unsigned long i = 0; i < ITERATIONS; i++){
+                struct field_hit hit;
+                if(sweepField(&BLOCK->field, &BLOCK->sweeps[i % SWEEPS], &hit)){
+                        hits += hit.brick + hit.time;
+                }
+        }
+
+        sink += hits;
+}
+
+/* SIDE bricks by SIDE, centred in the court */
+static unsigned initBrickBlock(struct brick_block *const block, const unsigned SIDE){
+        const int LEFT = (WIDTH - (int)SIDE*BRICK_PITCH)/2;
+        const int TOP = (HEIGHT - (int)SIDE*BRICK_PITCH)/2;
+        struct brick *const bricks = malloc(sizeof(*bricks)*SIDE*SIDE);
+        if(!bricks){
+                return 1;
+        }
+        for(unsigned i = 0; i < SIDE*SIDE; i++){
+                bricks[i] = (struct brick){ .box = { .x = LEFT + (int)(i % SIDE)*BRICK_PITCH, .y = TOP + (int)(i/SIDE)*BRICK_PITCH, .w = BRICK_SIZE, .h = BRICK_SIZE }, .strength = BRICK_SOLID };
+        }
+        const unsigned FAILED = initField(&block->field, bricks, SIDE*SIDE);
+        free(bricks);
+        if(FAILED){
+                return 1;
+        }
+
+        struct world rng = WORLD_INITIALIZER;
+        seedWorld(&rng, BRICK_SEED);
+        const unsigned RANGE = SIDE*BRICK_PITCH - BALL_WIDTH;
+        for(unsigned i = 0; i < SWEEPS; i++){
+                block->sweeps[i] = (struct field_sweep){
+                        .x = LEFT + worldRandom(&rng) % RANGE,
+                        .y = (int64_t)(TOP + worldRandom(&rng) % RANGE)*10,
+                        .direction = (worldRandom(&rng) % 2) ? 1 : -1,
+                        .y_vel = (int)(worldRandom(&rng) % 11) - 5,
+                        .span = 10,
+                        .scale = 10,
+                        .w = BALL_WIDTH,
+                        .h = BALL_HEIGHT
+                };
+        }
+
+        return 0;
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bot.h"
+#include "world.h"
+
+/* Reaction delay in ticks and aim error in pixels of each level */
+static const struct{
+        unsigned delay;
+        int error;
+} LEVELS[BOT_LEVELS] = {
+        { .delay = 10, .error = 48 },
+        { .delay = 5, .error = 24 },
+        { .delay = 1, .error = 8 }
+};
+
+static uint32_t botRandom(struct bot *const bot);
+
+/* Steers the paddle toward the target, which is only recomputed when the
+ * ball's velocity changes or the ball is served, so that the bot costs a
+ * few comparisons on most ticks */
+void driveBot(struct bot *const bot, struct player *const player, const struct character *const ball){
+        const unsigned SERVED = ball->box.x != bot->x + bot->x_vel;
+        const unsigned TURNED = ball->x_vel != bot->x_vel;
+        if(SERVED || TURNED || ball->y_vel != bot->y_vel){
+                if(SERVED || TURNED){
+                        bot->wait = bot->delay;
+                        bot->aim = bot->error ? (int)(botRandom(bot) % (2*bot->error + 1)) - bot->error : 0;
+                }
+                bot->x_vel = ball->x_vel;
+                bot->y_vel = ball->y_vel;
+                bot->target = interceptY(ball, &player->avatar.box) + ball->box.h/2 + bot->aim;
+        }
+        bot->x = ball->box.x;
+
+        /* until it reacts, the bot keeps heading for where it was going */
+        if(bot->wait){
+                bot->wait--;
+        }
+
+        const int CENTER = player->avatar.box.y + player->avatar.box.h/2;
+        const int GOAL = bot->wait ? CENTER + player->avatar.y_vel : bot->target;
+        if(abs(GOAL - CENTER) < 10){
+                player->avatar.y_vel = 0;
+        }else{
+                player->avatar.y_vel = (GOAL > CENTER) ? 10 : -10;
+        }
+}
+
+void initBot(struct bot *const bot, const unsigned LEVEL, const uint64_t SEED){
+        *bot = (struct bot){
+                .delay = LEVELS[LEVEL - 1].delay,
+                .error = LEVELS[LEVEL - 1].error,
+                .rng = SEED,
+                .target = HEIGHT/2
+        };
+}
+
+/* The top of the ball when it next reaches the face of the paddle, or
+ * the middle of the court should the ball be heading away. The walls
+ * are folded in as stepWorld() does, so the answer is exact. */
+int interceptY(const struct character *const ball, const struct box *const paddle){
+        const unsigned LEFT_SIDE = paddle->x < WIDTH/2;
+        const int SPEED = abs(ball->x_vel);
+        if(!SPEED || (ball->x_vel < 0) != LEFT_SIDE){
+                return (HEIGHT - ball->box.h)/2;
+        }
+
+        const int GAP = LEFT_SIDE ? ball->box.x - (paddle->x + paddle->w) : paddle->x - (ball->box.x + ball->box.w);
+        unsigned turned;
+        const int64_t Y = foldPosition((int64_t)ball->box.y*SPEED + (int64_t)ball->y_vel*((GAP > 0) ? GAP : 0), (int64_t)(HEIGHT - ball->box.h)*SPEED, &turned);
+
+        return (Y + SPEED/2)/SPEED;
+}
+
+/* A sequence of its own, kept apart from the world's so that the bot
+ * does not change how the match plays out */
+static uint32_t botRandom(struct bot *const bot){
+        return mixRandom(&bot->rng) >> 32;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdint.h>
+
+#include "world.h"
+
+#define BOT_LEVELS 3
+
+/* CPU opponent. It aims for where the ball will cross its paddle, worked
+ * out in closed form whenever the ball changes course, and is made
+ * beatable by reacting DELAY ticks late and missing its aim by up to
+ * ERROR pixels. The rest of the fields are the course it last saw. */
+struct bot{
+        unsigned delay;
+        int error;
+        uint64_t rng;
+        int x;
+        int x_vel;
+        int y_vel;
+        int aim;
+        unsigned wait;
+        int target;
+};
+
+void driveBot(struct bot *const bot, struct player *const player, const struct character *const ball);
+void initBot(struct bot *const bot, const unsigned LEVEL, const uint64_t SEED);
+int interceptY(const struct character *const ball, const struct box *const paddle);
+
+#endif
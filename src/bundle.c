@@ -0,0 +1,94 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bundle.h"
+
+void closeBundle(struct bundle *const bundle){
+        munmap((void *)bundle->header, bundle->size);
+}
+
+/* A missing bundle is not reported, so that the caller may quietly fall
+ * back to loading the media files themselves */
+unsigned openBundle(const char *const PATH, struct bundle *const bundle){
+        const int FD = open(PATH, O_RDONLY);
+        if(FD < 0){
+                if(errno != ENOENT){
+                        fprintf(stderr, "*** Error: Unable to open bundle \"%s\": %s\n", PATH, strerror(errno));
+                }
+                return 1;
+        }
+
+        struct stat st;
+        if(fstat(FD, &st)){
+                fprintf(stderr, "*** Error: Unable to stat bundle \"%s\": %s\n", PATH, strerror(errno));
+                goto err_fstat;
+        }
+        if((size_t)st.st_size < sizeof(struct bundle_header)){
+                fprintf(stderr, "*** Error: Bundle \"%s\" is truncated\n", PATH);
+                goto err_truncated;
+        }
+
+        void *const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+        if(map == MAP_FAILED){
+                fprintf(stderr, "*** Error: Unable to map bundle \"%s\": %s\n", PATH, strerror(errno));
+                goto err_mmap;
+        }
+        close(FD);
+
+        const struct bundle_header *const HEADER = map;
+        if(memcmp(HEADER->magic, BUNDLE_MAGIC, sizeof(HEADER->magic)) || HEADER->version != BUNDLE_VERSION || HEADER->entries != ATLAS_ENTRIES){
+                fprintf(stderr, "*** Error: \"%s\" is not a compatible bundle\n", PATH);
+                goto err_invalid;
+        }
+        if(HEADER->offset < sizeof(*HEADER) || HEADER->offset > (uint64_t)st.st_size || (uint64_t)HEADER->pitch*HEADER->h > (uint64_t)st.st_size - HEADER->offset){
+                fprintf(stderr, "*** Error: Bundle \"%s\" is truncated\n", PATH);
+                goto err_invalid;
+        }
+
+        bundle->header = HEADER;
+        bundle->pixels = (const char *)map + HEADER->offset;
+        bundle->size = st.st_size;
+
+        return 0;
+
+err_invalid:
+        munmap(map, st.st_size);
+        return 1;
+err_mmap:
+err_truncated:
+err_fstat:
+        close(FD);
+        return 1;
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atlas.h"
+
+#define BUNDLE_MAGIC "FBPB"
+#define BUNDLE_VERSION 2
+#define BUNDLE_ALIGN 64
+
+/* A bundle is the packed sprite atlas as produced by mkbundle: this
+ * header, followed at the given offset by raw pixel rows ready to be
+ * handed to SDL_UpdateTexture. Fields are in host byte order, as the
+ * bundle is generated on the build machine. */
+struct bundle_rect{
+        int32_t x;
+        int32_t y;
+        int32_t w;
+        int32_t h;
+};
+
+struct bundle_header{
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t w;
+        uint32_t h;
+        uint32_t pitch;
+        uint32_t offset;
+        uint32_t entries;
+        struct bundle_rect rects[ATLAS_ENTRIES];
+};
+
+struct bundle{
+        const struct bundle_header *header;
+        const void *pixels;
+        size_t size;
+};
+
+void closeBundle(struct bundle *const bundle);
+unsigned openBundle(const char *const PATH, struct bundle *const bundle);
+
+#endif
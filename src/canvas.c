@@ -0,0 +1,266 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CANVAS_X86 1
+#include <immintrin.h>
+#endif
+
+#include "atlas.h"
+#include "canvas.h"
+#include "render.h"
+#include "world.h"
+
+#define CANVAS_OPAQUE 0xFF000000u
+
+/* Blends COUNT pixels of SRC over DEST */
+typedef void (*canvas_kernel_fn)(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT);
+
+static void blendScalar(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT);
+static void blitSprite(const struct canvas *const canvas, uint32_t *const target, const enum atlas_entry ENTRY, const int X, const int Y);
+static void paintLayer(struct canvas *const canvas, const struct world *const WORLD);
+static void paintScore(const struct canvas *const canvas, const unsigned SCORE, const int X);
+#ifdef CANVAS_X86
+static void blendAVX2(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT);
+static void blendSSE2(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT);
+#endif
+
+const char *const CANVAS_KERNEL_NAMES[CANVAS_KERNELS] = {
+        [CANVAS_SCALAR] = "scalar",
+        [CANVAS_SSE2] = "sse2",
+        [CANVAS_AVX2] = "avx2"
+};
+
+static const canvas_kernel_fn KERNELS[CANVAS_KERNELS] = {
+        [CANVAS_SCALAR] = blendScalar,
+#ifdef CANVAS_X86
+        [CANVAS_SSE2] = blendSSE2,
+        [CANVAS_AVX2] = blendAVX2
+#endif
+};
+
+enum canvas_kernel bestCanvasKernel(void){
+#ifdef CANVAS_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")){
+                return CANVAS_AVX2;
+        }
+        if(__builtin_cpu_supports("sse2")){
+                return CANVAS_SSE2;
+        }
+#endif
+        return CANVAS_SCALAR;
+}
+
+void freeCanvas(struct canvas *const canvas){
+        free(canvas->pixels);
+        free(canvas->sprites);
+        canvas->pixels = NULL;
+        canvas->layer = NULL;
+        canvas->sprites = NULL;
+}
+
+/* PIXELS are the atlas's ARGB8888 rows, PITCH bytes apart */
+unsigned initCanvas(struct canvas *const canvas, const struct atlas *const ATLAS, const void *const PIXELS, const int PITCH, const enum canvas_kernel KERNEL){
+        if(!KERNELS[KERNEL]){
+                fprintf(stderr, "*** Error: The %s kernel is not available on this platform\n", CANVAS_KERNEL_NAMES[KERNEL]);
+                return 1;
+        }
+
+        canvas->pixels = malloc(2*sizeof(*canvas->pixels)*WIDTH*HEIGHT);
+        if(!canvas->pixels){
+                fprintf(stderr, "*** Error: Unable to allocate framebuffer\n");
+                return 1;
+        }
+        canvas->layer = canvas->pixels + WIDTH*HEIGHT;
+
+        canvas->sprites = malloc(sizeof(*canvas->sprites)*ATLAS->w*ATLAS->h);
+        if(!canvas->sprites){
+                fprintf(stderr, "*** Error: Unable to allocate %dx%d sprite atlas\n", ATLAS->w, ATLAS->h);
+                free(canvas->pixels);
+                canvas->pixels = NULL;
+                return 1;
+        }
+        for(int y = 0; y < ATLAS->h; y++){
+                memcpy(&canvas->sprites[y*ATLAS->w], (const unsigned char *)PIXELS + (size_t)y*PITCH, sizeof(*canvas->sprites)*ATLAS->w);
+        }
+
+        canvas->atlas = *ATLAS;
+        canvas->kernel = KERNEL;
+        canvas->valid = 0;
+
+        return 0;
+}
+
+/* Sprites are drawn at their size in the atlas, which is also the size
+ * of the ball and paddles in the world */
+void paintWorld(struct canvas *const canvas, const struct world *const WORLD){
+        if(!canvas->valid || canvas->score1 != WORLD->player1.score || canvas->score2 != WORLD->player2.score){
+                paintLayer(canvas, WORLD);
+        }
+        memcpy(canvas->pixels, canvas->layer, sizeof(*canvas->pixels)*WIDTH*HEIGHT);
+
+        blitSprite(canvas, canvas->pixels, ATLAS_BALL, WORLD->ball.box.x, WORLD->ball.box.y);
+        blitSprite(canvas, canvas->pixels, ATLAS_PADDLE1, WORLD->player1.avatar.box.x, WORLD->player1.avatar.box.y);
+        blitSprite(canvas, canvas->pixels, ATLAS_PADDLE2, WORLD->player2.avatar.box.x, WORLD->player2.avatar.box.y);
+}
+
+/* Every kernel divides by 255 with the same rounding, so that frames do
+ * not depend on the processor they were drawn on */
+static void blendScalar(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT){
+        for(unsigned i = 0; i < COUNT; i++){
+                const uint32_t S = SRC[i];
+                const uint32_t D = dest[i];
+                const uint32_t A = S >> 24;
+
+                uint32_t out = CANVAS_OPAQUE;
+                for(unsigned shift = 0; shift < 24; shift += 8){
+                        const uint32_t T = ((S >> shift) & 0xFF)*A + ((D >> shift) & 0xFF)*(255 - A) + 128;
+                        out |= ((T + (T >> 8)) >> 8) << shift;
+                }
+                dest[i] = out;
+        }
+}
+
+static void blitSprite(const struct canvas *const canvas, uint32_t *const target, const enum atlas_entry ENTRY, const int X, const int Y){
+        const SDL_Rect *const SRC = &canvas->atlas.rects[ENTRY];
+        int x = X;
+        int y = Y;
+        int src_x = SRC->x;
+        int src_y = SRC->y;
+        int w = SRC->w;
+        int h = SRC->h;
+
+        if(x < 0){
+                src_x -= x;
+                w += x;
+                x = 0;
+        }
+        if(y < 0){
+                src_y -= y;
+                h += y;
+                y = 0;
+        }
+        if(x + w > WIDTH){
+                w = WIDTH - x;
+        }
+        if(y + h > HEIGHT){
+                h = HEIGHT - y;
+        }
+        if(w <= 0 || h <= 0){
+                return;
+        }
+
+        const canvas_kernel_fn BLEND = KERNELS[canvas->kernel];
+        for(int row = 0; row < h; row++){
+                BLEND(&target[(y + row)*WIDTH + x], &canvas->sprites[(src_y + row)*canvas->atlas.w + src_x], w);
+        }
+}
+
+static void paintLayer(struct canvas *const canvas, const struct world *const WORLD){
+        for(unsigned i = 0; i < WIDTH*HEIGHT; i++){
+                canvas->layer[i] = CANVAS_OPAQUE;
+        }
+
+        blitSprite(canvas, canvas->layer, ATLAS_BACKGROUND, 0, 0);
+        paintScore(canvas, WORLD->player1.score, SCORE1_X);
+        paintScore(canvas, WORLD->player2.score, SCORE2_X);
+
+        canvas->score1 = WORLD->player1.score;
+        canvas->score2 = WORLD->player2.score;
+        canvas->valid = 1;
+}
+
+static void paintScore(const struct canvas *const canvas, const unsigned SCORE, const int X){
+        char score_str[16];
+        snprintf(score_str, sizeof(score_str), "%u", SCORE);
+
+        int x = X;
+        for(const char *digit = score_str; *digit; digit++){
+                const enum atlas_entry ENTRY = ATLAS_DIGIT0 + (*digit - '0');
+                blitSprite(canvas, canvas->layer, ENTRY, x, 0);
+                x += canvas->atlas.rects[ENTRY].w;
+        }
+}
+
+#ifdef CANVAS_X86
+/* Each pixel is widened to four 16-bit channels, so that
+ * S*A + D*(255 - A) + 128 never exceeds 65535 */
+__attribute__((target("avx2")))
+static inline __m256i blendWideAVX2(const __m256i S, const __m256i D){
+        const __m256i A = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(S, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m256i T = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(S, A), _mm256_mullo_epi16(D, _mm256_sub_epi16(_mm256_set1_epi16(255), A))), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(T, _mm256_srli_epi16(T, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i blendWideSSE2(const __m128i S, const __m128i D){
+        const __m128i A = _mm_shufflehi_epi16(_mm_shufflelo_epi16(S, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i T = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(S, A), _mm_mullo_epi16(D, _mm_sub_epi16(_mm_set1_epi16(255), A))), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(T, _mm_srli_epi16(T, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void blendAVX2(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT){
+        const __m256i ZERO = _mm256_setzero_si256();
+        const __m256i OPAQUE = _mm256_set1_epi32(CANVAS_OPAQUE);
+
+        const unsigned VECTORS = COUNT & ~7u;
+        for(unsigned i = 0; i < VECTORS; i += 8){
+                const __m256i S = _mm256_loadu_si256((const __m256i *)&SRC[i]);
+                const __m256i D = _mm256_loadu_si256((const __m256i *)&dest[i]);
+
+                const __m256i LO = blendWideAVX2(_mm256_unpacklo_epi8(S, ZERO), _mm256_unpacklo_epi8(D, ZERO));
+                const __m256i HI = blendWideAVX2(_mm256_unpackhi_epi8(S, ZERO), _mm256_unpackhi_epi8(D, ZERO));
+                _mm256_storeu_si256((__m256i *)&dest[i], _mm256_or_si256(_mm256_packus_epi16(LO, HI), OPAQUE));
+        }
+
+        blendScalar(dest + VECTORS, SRC + VECTORS, COUNT - VECTORS);
+}
+
+__attribute__((target("sse2")))
+static void blendSSE2(uint32_t *const dest, const uint32_t *const SRC, const unsigned COUNT){
+        const __m128i ZERO = _mm_setzero_si128();
+        const __m128i OPAQUE = _mm_set1_epi32(CANVAS_OPAQUE);
+
+        const unsigned VECTORS = COUNT & ~3u;
+        for(unsigned i = 0; i < VECTORS; i += 4){
+                const __m128i S = _mm_loadu_si128((const __m128i *)&SRC[i]);
+                const __m128i D = _mm_loadu_si128((const __m128i *)&dest[i]);
+
+                const __m128i LO = blendWideSSE2(_mm_unpacklo_epi8(S, ZERO), _mm_unpacklo_epi8(D, ZERO));
+                const __m128i HI = blendWideSSE2(_mm_unpackhi_epi8(S, ZERO), _mm_unpackhi_epi8(D, ZERO));
+                _mm_storeu_si128((__m128i *)&dest[i], _mm_or_si128(_mm_packus_epi16(LO, HI), OPAQUE));
+        }
+
+        blendScalar(dest + VECTORS, SRC + VECTORS, COUNT - VECTORS);
+}
+#endif
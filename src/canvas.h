@@ -0,0 +1,66 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <stdint.h>
+
+#include "atlas.h"
+#include "world.h"
+
+enum canvas_kernel{
+        CANVAS_SCALAR,
+        CANVAS_SSE2,
+        CANVAS_AVX2,
+        CANVAS_KERNELS
+};
+
+/* A framebuffer in memory, for drawing frames without a display or
+ * GPU. Pixels are ARGB8888 rows of WIDTH, and always opaque. Sprites
+ * are alpha blended from a private copy of the atlas, and the
+ * background and scores are cached in a layer of their own, as with
+ * the renderer, which is only redrawn when a score changes. */
+struct canvas{
+        uint32_t *pixels;
+        uint32_t *layer;
+        uint32_t *sprites;
+        struct atlas atlas;
+        enum canvas_kernel kernel;
+        unsigned score1;
+        unsigned score2;
+        unsigned valid;
+};
+
+extern const char *const CANVAS_KERNEL_NAMES[CANVAS_KERNELS];
+
+enum canvas_kernel bestCanvasKernel(void);
+void freeCanvas(struct canvas *const canvas);
+unsigned initCanvas(struct canvas *const canvas, const struct atlas *const ATLAS, const void *const PIXELS, const int PITCH, const enum canvas_kernel KERNEL);
+void paintWorld(struct canvas *const canvas, const struct world *const WORLD);
+
+#endif
@@ -0,0 +1,329 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "field.h"
+#include "world.h"
+
+/* Room for a row of the narrowest tiles across the court, the newline
+ * and the terminator */
+#define LINE_SIZE (WIDTH + 2)
+
+static void cellRange(const struct box *const BOX, unsigned *const column0, unsigned *const column1, unsigned *const row0, unsigned *const row1);
+static void fillCells(struct field *const field);
+static void testBrick(const struct field *const FIELD, const uint32_t BRICK, const struct field_sweep *const SWEEP, struct field_hit *const hit, unsigned *const found);
+
+void freeField(struct field *const field){
+        free(field->bricks);
+        free(field->alive);
+        free(field->cells);
+        *field = (struct field){ .bricks = NULL };
+}
+
+/* Takes one hit off BRICK, and breaks it if that was its last, taking it
+ * out of the grid; returns whether it broke */
+unsigned hitBrick(struct field *const field, const unsigned BRICK){
+        struct brick *const brick = &field->bricks[BRICK];
+        if(brick->strength == BRICK_SOLID || !(field->alive[BRICK/64] >> BRICK % 64 & 1) || --brick->hits){
+                return 0;
+        }
+
+        unsigned column0, column1, row0, row1;
+        cellRange(&brick->box, &column0, &column1, &row0, &row1);
+        for(unsigned row = row0; row <= row1; row++){
+                for(unsigned column = column0; column <= column1; column++){
+                        const unsigned CELL = row*FIELD_COLUMNS + column;
+                        uint32_t *const list = &field->cells[field->starts[CELL]];
+                        for(uint32_t i = 0; i < field->counts[CELL]; i++){
+                                if(list[i] == BRICK){
+                                        list[i] = list[--field->counts[CELL]];
+                                        list[field->counts[CELL]] = BRICK;
+                                        break;
+                                }
+                        }
+                }
+        }
+        field->alive[BRICK/64] &= ~((uint64_t)1 << BRICK % 64);
+        field->version++;
+
+        return 1;
+}
+
+/* The field keeps its own copy of BRICKS, each of which must lie within
+ * the court; they start out unbroken */
+unsigned initField(struct field *const field, const struct brick *const BRICKS, const unsigned COUNT){
+        *field = (struct field){ .count = COUNT };
+        if(COUNT > FIELD_MAX_BRICKS){
+                fprintf(stderr, "*** Error: %u bricks is more than the %u a field can hold\n", COUNT, FIELD_MAX_BRICKS);
+                return 1;
+        }
+
+        size_t entries = 0;
+        for(unsigned i = 0; i < COUNT; i++){
+                const struct box *const BOX = &BRICKS[i].box;
+                if(BOX->w <= 0 || BOX->h <= 0 || BOX->x < 0 || BOX->y < 0 || BOX->x > WIDTH - BOX->w || BOX->y > HEIGHT - BOX->h){
+                        fprintf(stderr, "*** Error: Brick %u lies outside the court\n", i);
+                        return 1;
+                }
+
+                unsigned column0, column1, row0, row1;
+                cellRange(BOX, &column0, &column1, &row0, &row1);
+                for(unsigned row = row0; row <= row1; row++){
+                        for(unsigned column = column0; column <= column1; column++){
+                                field->counts[row*FIELD_COLUMNS + column]++;
+                        }
+                }
+                entries += (size_t)(column1 - column0 + 1)*(row1 - row0 + 1);
+        }
+
+        field->bricks = malloc(sizeof(*field->bricks)*(COUNT ? COUNT : 1));
+        field->alive = malloc(sizeof(*field->alive)*((COUNT + 63)/64 + 1));
+        field->cells = malloc(sizeof(*field->cells)*(entries ? entries : 1));
+        if(!field->bricks || !field->alive || !field->cells){
+                fprintf(stderr, "*** Error: Unable to allocate field of %u bricks\n", COUNT);
+                freeField(field);
+                return 1;
+        }
+        memcpy(field->bricks, BRICKS, sizeof(*BRICKS)*COUNT);
+
+        for(unsigned i = 0; i < FIELD_CELLS; i++){
+                field->starts[i + 1] = field->starts[i] + field->counts[i];
+        }
+        resetField(field);
+
+        return 0;
+}
+
+/* A level is the line "FBPL 1 W H", giving the size of its tiles, then
+ * a line for each row of tiles down from the top of the court, with a
+ * character for each tile along from its left: '.' or ' ' for none, '#'
+ * for a brick that never breaks, or '1' to '9' for one that breaks
+ * after that many hits. The paddles' columns and the middle of the
+ * court, where the ball is served, are best left clear. */
+unsigned loadLevel(const char *const PATH, struct field *const field){
+        FILE *const file = fopen(PATH, "r");
+        if(!file){
+                fprintf(stderr, "*** Error: Unable to open level \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        char line[LINE_SIZE];
+        unsigned version, tile_w, tile_h;
+        if(!fgets(line, sizeof(line), file) || sscanf(line, LEVEL_MAGIC " %u %u %u", &version, &tile_w, &tile_h) != 3 || version != LEVEL_VERSION || !tile_w || !tile_h || tile_w > WIDTH || tile_h > HEIGHT){
+                fprintf(stderr, "*** Error: \"%s\" is not a compatible level\n", PATH);
+                goto err_header;
+        }
+
+        struct brick *bricks = NULL;
+        unsigned count = 0;
+        unsigned capacity = 0;
+        for(unsigned row = 0; fgets(line, sizeof(line), file); row++){
+                const size_t LENGTH = strcspn(line, "\r\n");
+                if(!line[LENGTH] && !feof(file)){
+                        fprintf(stderr, "*** Error: Level \"%s\" is wider than the court at row %u\n", PATH, row + 1);
+                        goto err_row;
+                }
+
+                for(unsigned column = 0; column < LENGTH; column++){
+                        const char TILE = line[column];
+                        if(TILE == '.' || TILE == ' '){
+                                continue;
+                        }
+                        if(TILE != '#' && (TILE < '1' || TILE > '9')){
+                                fprintf(stderr, "*** Error: Invalid tile '%c' in level \"%s\" at row %u, column %u\n", TILE, PATH, row + 1, column + 1);
+                                goto err_row;
+                        }
+                        if((column + 1)*tile_w > WIDTH || (row + 1)*tile_h > HEIGHT){
+                                fprintf(stderr, "*** Error: Level \"%s\" extends past the court at row %u, column %u\n", PATH, row + 1, column + 1);
+                                goto err_row;
+                        }
+
+                        if(count == capacity){
+                                capacity = capacity ? 2*capacity : 256;
+                                struct brick *const grown = realloc(bricks, sizeof(*bricks)*capacity);
+                                if(!grown){
+                                        fprintf(stderr, "*** Error: Unable to allocate bricks of level \"%s\"\n", PATH);
+                                        goto err_row;
+                                }
+                                bricks = grown;
+                        }
+                        const unsigned STRENGTH = (TILE == '#') ? BRICK_SOLID : (unsigned)(TILE - '0');
+                        bricks[count++] = (struct brick){ .box = { .x = column*tile_w, .y = row*tile_h, .w = tile_w, .h = tile_h }, .strength = STRENGTH, .hits = STRENGTH };
+                }
+        }
+        if(ferror(file)){
+                fprintf(stderr, "*** Error: Unable to read level \"%s\"\n", PATH);
+                goto err_row;
+        }
+        fclose(file);
+
+        const unsigned FAILED = initField(field, bricks, count);
+        free(bricks);
+
+        return FAILED;
+
+err_row:
+        free(bricks);
+err_header:
+        fclose(file);
+        return 1;
+}
+
+/* Mends every brick and puts each back into the cells it covers, in the
+ * order they were given, so that a reset field always plays the same */
+void resetField(struct field *const field){
+        for(unsigned i = 0; i < field->count; i++){
+                field->bricks[i].hits = field->bricks[i].strength;
+        }
+        memset(field->alive, 0, sizeof(*field->alive)*((field->count + 63)/64 + 1));
+        for(unsigned i = 0; i < field->count; i++){
+                field->alive[i/64] |= (uint64_t)1 << i % 64;
+        }
+        fillCells(field);
+        field->version++;
+}
+
+/* Whether the sweep meets BOX, and if so when: a top or bottom face
+ * wins a tie with a left or right one */
+unsigned sweepBox(const struct box *const BOX, const struct field_sweep *const SWEEP, struct field_hit *const hit){
+        const int64_t TOP = (int64_t)BOX->y*SWEEP->scale;
+        const int64_t BOTTOM = (int64_t)(BOX->y + BOX->h)*SWEEP->scale;
+        const int64_t HEIGHT_SCALED = (int64_t)SWEEP->h*SWEEP->scale;
+        unsigned found = 0;
+
+        if(SWEEP->direction){
+                const int64_t FACE = (SWEEP->direction > 0) ? BOX->x - SWEEP->w : BOX->x + BOX->w;
+                const int64_t TIME = (FACE - SWEEP->x)*SWEEP->direction;
+                const int64_t Y = SWEEP->y + SWEEP->y_vel*TIME;
+                /* meeting a corner, the ball goes on into the box unless it
+                 * is heading away along the other axis too */
+                const unsigned OVERLAP = (Y < BOTTOM || (Y == BOTTOM && SWEEP->y_vel < 0)) && (Y + HEIGHT_SCALED > TOP || (Y + HEIGHT_SCALED == TOP && SWEEP->y_vel > 0));
+                if(TIME >= 0 && TIME < SWEEP->span && OVERLAP){
+                        *hit = (struct field_hit){ .time = TIME, .y = Y, .vertical = 1 };
+                        found = 1;
+                }
+        }
+
+        if(SWEEP->y_vel){
+                const int64_t FACE = (SWEEP->y_vel > 0) ? TOP - HEIGHT_SCALED : BOTTOM;
+                const int64_t GAP = (SWEEP->y_vel > 0) ? FACE - SWEEP->y : SWEEP->y - FACE;
+                const int64_t SPEED = (SWEEP->y_vel > 0) ? SWEEP->y_vel : -SWEEP->y_vel;
+                const int64_t TIME = (GAP + SPEED - 1)/SPEED;
+                const int64_t X = SWEEP->x + SWEEP->direction*TIME;
+                if(GAP >= 0 && TIME <= SWEEP->span && X < BOX->x + BOX->w && X + SWEEP->w > BOX->x && (!found || TIME <= hit->time)){
+                        *hit = (struct field_hit){ .time = TIME, .y = FACE, .vertical = 0 };
+                        found = 1;
+                }
+        }
+
+        return found;
+}
+
+/* Only the bricks in the cells that the sweep's bounding box covers are
+ * tested, so the cost depends on how crowded the ball's surroundings
+ * are rather than on how many bricks there are. The ball meets a brick
+ * when it reaches one of its faces while overlapping it along the other
+ * axis; a top or bottom face is met at the first whole pixel of
+ * horizontal travel at which the ball has reached it. Bricks the ball
+ * already overlaps are passed through, and the earliest hit is taken,
+ * a top or bottom before a side, which is met exactly and so can wait,
+ * and the brick given first before the others, so that no order of the
+ * grid can change it. */
+unsigned sweepField(const struct field *const FIELD, const struct field_sweep *const SWEEP, struct field_hit *const hit){
+        const int64_t X_END = SWEEP->x + SWEEP->direction*SWEEP->span;
+        const int64_t Y_END = SWEEP->y + SWEEP->y_vel*SWEEP->span;
+        const int64_t Y_MIN = (SWEEP->y < Y_END) ? SWEEP->y : Y_END;
+        const int64_t Y_MAX = (SWEEP->y > Y_END) ? SWEEP->y : Y_END;
+        const struct box BOUNDS = {
+                .x = (SWEEP->x < X_END) ? SWEEP->x : X_END,
+                .y = (Y_MIN > 0) ? Y_MIN/SWEEP->scale : 0,
+                .w = SWEEP->span + SWEEP->w,
+                .h = (Y_MAX + SWEEP->scale - 1)/SWEEP->scale - ((Y_MIN > 0) ? Y_MIN/SWEEP->scale : 0) + SWEEP->h
+        };
+
+        unsigned column0, column1, row0, row1;
+        cellRange(&BOUNDS, &column0, &column1, &row0, &row1);
+        unsigned found = 0;
+        for(unsigned row = row0; row <= row1; row++){
+                for(unsigned column = column0; column <= column1; column++){
+                        const unsigned CELL = row*FIELD_COLUMNS + column;
+                        const uint32_t *const LIST = &FIELD->cells[FIELD->starts[CELL]];
+                        for(uint32_t i = 0; i < FIELD->counts[CELL]; i++){
+                                testBrick(FIELD, LIST[i], SWEEP, hit, &found);
+                        }
+                }
+        }
+
+        return found;
+}
+
+/* The cells BOX covers, clipped to the court */
+static void cellRange(const struct box *const BOX, unsigned *const column0, unsigned *const column1, unsigned *const row0, unsigned *const row1){
+        const int LEFT = (BOX->x > 0) ? BOX->x : 0;
+        const int TOP = (BOX->y > 0) ? BOX->y : 0;
+        const int RIGHT = (BOX->x + BOX->w - 1 < WIDTH - 1) ? BOX->x + BOX->w - 1 : WIDTH - 1;
+        const int BOTTOM = (BOX->y + BOX->h - 1 < HEIGHT - 1) ? BOX->y + BOX->h - 1 : HEIGHT - 1;
+
+        *column0 = (LEFT < RIGHT ? LEFT : RIGHT)/FIELD_CELL;
+        *column1 = (RIGHT > 0 ? RIGHT : 0)/FIELD_CELL;
+        *row0 = (TOP < BOTTOM ? TOP : BOTTOM)/FIELD_CELL;
+        *row1 = (BOTTOM > 0 ? BOTTOM : 0)/FIELD_CELL;
+}
+
+static void fillCells(struct field *const field){
+        memset(field->counts, 0, sizeof(field->counts));
+        for(unsigned i = 0; i < field->count; i++){
+                unsigned column0, column1, row0, row1;
+                cellRange(&field->bricks[i].box, &column0, &column1, &row0, &row1);
+                for(unsigned row = row0; row <= row1; row++){
+                        for(unsigned column = column0; column <= column1; column++){
+                                const unsigned CELL = row*FIELD_COLUMNS + column;
+                                field->cells[field->starts[CELL] + field->counts[CELL]++] = i;
+                        }
+                }
+        }
+}
+
+/* Records when the sweep meets BRICK, if it does and that is sooner
+ * than anything it has met so far; ties go to top and bottom faces over
+ * left and right ones, then to the lower brick */
+static void testBrick(const struct field *const FIELD, const uint32_t BRICK, const struct field_sweep *const SWEEP, struct field_hit *const hit, unsigned *const found){
+        struct field_hit box_hit;
+        if(!sweepBox(&FIELD->bricks[BRICK].box, SWEEP, &box_hit)){
+                return;
+        }
+
+        if(!*found || box_hit.time < hit->time || (box_hit.time == hit->time && (box_hit.vertical < hit->vertical || (box_hit.vertical == hit->vertical && BRICK < hit->brick)))){
+                *hit = box_hit;
+                hit->brick = BRICK;
+                *found = 1;
+        }
+}
@@ -0,0 +1,104 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef FIELD_H
+#define FIELD_H
+
+#include <stdint.h>
+
+#include "world.h"
+
+#define LEVEL_MAGIC "FBPL"
+#define LEVEL_VERSION 1
+#define FIELD_CELL 32
+#define FIELD_COLUMNS ((WIDTH + FIELD_CELL - 1)/FIELD_CELL)
+#define FIELD_ROWS ((HEIGHT + FIELD_CELL - 1)/FIELD_CELL)
+#define FIELD_CELLS (FIELD_COLUMNS*FIELD_ROWS)
+#define FIELD_MAX_BRICKS 65536
+#define BRICK_SOLID 0u
+
+/* An obstacle between the paddles. STRENGTH is how many hits it takes
+ * to break, or BRICK_SOLID if it never does, and HITS how many are
+ * left; a broken brick has none. */
+struct brick{
+        struct box box;
+        unsigned strength;
+        unsigned hits;
+};
+
+/* The obstacles of a level, with a uniform grid over the court for a
+ * broadphase: CELLS lists, for each cell in turn, the bricks overlapping
+ * it, with STARTS the offset of each cell's list and COUNTS how many of
+ * its bricks are unbroken, which come first. Breaking a brick swaps it
+ * out of the lists of just the cells it covers. ALIVE has a bit set for
+ * each unbroken brick, and VERSION counts the bricks broken so far,
+ * for whoever keeps a picture of the field. */
+struct field{
+        struct brick *bricks;
+        unsigned count;
+        unsigned long version;
+        uint64_t *alive;
+        uint32_t *cells;
+        uint32_t starts[FIELD_CELLS + 1];
+        uint32_t counts[FIELD_CELLS];
+};
+
+/* A stretch of the ball's path that crosses no wall, in the units of
+ * stepWorld(): X in pixels, Y in 1/SCALE of a pixel and SPAN in pixels
+ * of horizontal travel, each of which moves the ball DIRECTION pixels
+ * across and Y_VEL down */
+struct field_sweep{
+        int64_t x;
+        int64_t y;
+        int direction;
+        int64_t y_vel;
+        int64_t span;
+        int64_t scale;
+        int w;
+        int h;
+};
+
+/* The first brick the ball touches along a sweep, after TIME, and the
+ * Y at which it does; sweepBox() always clears BRICK. VERTICAL is set
+ * when the ball meets the brick's left or right face, and clear for the
+ * top or bottom. */
+struct field_hit{
+        unsigned brick;
+        int64_t time;
+        int64_t y;
+        unsigned vertical;
+};
+
+void freeField(struct field *const field);
+unsigned hitBrick(struct field *const field, const unsigned BRICK);
+unsigned initField(struct field *const field, const struct brick *const BRICKS, const unsigned COUNT);
+unsigned loadLevel(const char *const PATH, struct field *const field);
+void resetField(struct field *const field);
+unsigned sweepBox(const struct box *const BOX, const struct field_sweep *const SWEEP, struct field_hit *const hit);
+unsigned sweepField(const struct field *const FIELD, const struct field_sweep *const SWEEP, struct field_hit *const hit);
+
+#endif
@@ -25,212 +25,666 @@
  * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "SDL.h"
-#include "SDL_image.h"
-#include "SDL_ttf.h"
 
-#define WIDTH 640
-#define HEIGHT 480
-
-struct sprite{
-        SDL_Rect dimensions;
-        SDL_Texture *texture;
+#include "arena.h"
+#include "atlas.h"
+#include "batch.h"
+#include "bot.h"
+#include "bundle.h"
+#include "field.h"
+#include "canvas.h"
+#include "input.h"
+#include "loader.h"
+#include "match.h"
+#include "net.h"
+#include "pool.h"
+#include "profile.h"
+#include "render.h"
+#include "replay.h"
+#include "rollback.h"
+#include "snapshot.h"
+#include "video.h"
+#include "world.h"
+
+#define TICK_RATE 30
+#define FRAME_RATE 30
+#define BUNDLE_PATH "foobarpong.bundle"
+#define MEDIA_DIR "media"
+#define ARENA_SEED 0x2545F491u
+#define MAX_CATCHUP_TICKS 5
+#define MATCH_POINTS 11
+#define SEEK_TICKS (10*TICK_RATE)
+#define HELLO_INTERVAL 100
+#define CONNECT_TIMEOUT 30000
+#define PEER_TIMEOUT 10000
+#define PAUSE_POLL 50
+#define STALL_WAIT 1
+
+static struct atlas atlas;
+static SDL_Texture *atlas_texture;
+static struct batch batch;
+static struct layer layer;
+
+static struct arena arena;
+static enum arena_kernel arena_kernel;
+
+static struct field field;
+
+static struct replay replay;
+static struct playback playback;
+static unsigned recording;
+static unsigned replaying;
+
+static struct net net;
+static struct rollback rollback;
+static unsigned networked;
+static Uint64 last_heard;
+static unsigned long stalled_frames;
+static struct series resimulation;
+
+static struct input_queue inputs;
+static struct bot bot;
+static unsigned bot_level;
+static Uint64 last_input;
+
+static pthread_t simulation;
+static struct snapshots snapshots;
+static unsigned sim_quit;
+static unsigned sim_paused;
+static unsigned sim_failed;
+static struct series tick_interval;
+
+static struct profile profile;
+static unsigned profiling;
+static unsigned hud;
+
+struct options{
+        unsigned balls;
+        unsigned bot;
+        const char *bundle;
+        const char *export;
+        enum video_format export_format;
+        unsigned headless;
+        unsigned long ticks;
+        unsigned matches;
+        const char *level;
+        unsigned threads;
+        unsigned long seed;
+        const char *record;
+        const char *replay;
+        unsigned long seek;
+        const char *peer;
+        const char *port;
+        unsigned player;
+        struct net_shim shim;
+        const char *profile;
+        unsigned fps;
+        unsigned vsync;
+        unsigned render_delay;
+        unsigned stats;
+        unsigned software;
 };
-static struct sprite background;
 
-struct character{
-        struct sprite sprite;
-        int x_vel;
-        int y_vel;
+struct series{
+        unsigned long count;
+        double mean;
+        double m2;
+        double max;
 };
-static struct character ball = { .x_vel = 10 };
 
-struct player{
-        struct character avatar;
-        unsigned score;
-        struct sprite score_display;
+struct frame_stats{
+        struct series interval;
+        struct series draw;
+        struct series latency;
+        clock_t cpu_start;
+        Uint64 first_frame;
+        Uint64 interactive;
 };
-static struct player player1 = { .score_display.dimensions.x = WIDTH/4 };
-static struct player player2 = { .score_display.dimensions.x = WIDTH - WIDTH/4 };
 
-static TTF_Font *font;
+static struct world world = WORLD_INITIALIZER;
+static struct world shown = WORLD_INITIALIZER;
+static struct arena shown_arena;
+static struct scene scene = { .atlas = &atlas, .batch = &batch, .world = &shown, .arena = &shown_arena };
 
+static unsigned applyInputs(const Uint64 DEADLINE);
+static void bundleAtlas(const struct bundle_header *const HEADER, struct atlas *const atlas);
 static void closeDisplay(SDL_Window *const window, SDL_Renderer *const renderer);
-static unsigned drawWorld(SDL_Renderer *const renderer);
+static unsigned connectPeer(const struct options *const options);
+static void fillSnapshot(struct snapshot *const snapshot, const Uint64 TIME);
 static void freeFiles(void);
-static unsigned handleEvents(unsigned *const running, SDL_Renderer *const renderer);
-static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const renderer);
-static unsigned loadFiles(SDL_Renderer *const renderer);
-static unsigned loadSprite(const char *const PATH, struct sprite *const sprite, SDL_Renderer *const renderer);
-static void moveCharacter(struct character *character);
-static unsigned newGame(SDL_Renderer *const renderer);
-static void paddleBounce(void);
-static unsigned processWorld(SDL_Renderer *const renderer);
-static void resetBall(void);
-static unsigned updateScoreTexture(struct player *const player, SDL_Renderer *const renderer);
-
-int main(void){
-        srand(time(NULL));
+static Uint64 eventTime(const Uint32 TIMESTAMP, const Uint64 NOW, const Uint32 NOW_MS, const Uint64 FREQUENCY);
+static void handleEvents(unsigned *const running, unsigned *const idle);
+static void handleReplayKey(const SDL_Keycode KEY, const Uint64 TIME, unsigned *const running);
+static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const renderer, const struct options *const options);
+static unsigned loadBundle(struct bundle *const bundle, SDL_Renderer *const renderer);
+static unsigned loadCanvas(struct canvas *const canvas, const char *const BUNDLE);
+static unsigned loadFiles(SDL_Renderer *const renderer, struct loader *const loader);
+static unsigned loadMedia(SDL_Renderer *const renderer, const struct loader *const LOADER);
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options);
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number);
+static unsigned pollNet(void);
+static void printFrameStats(const struct frame_stats *const stats);
+static void printNetStats(const unsigned long FRAMES);
+static void printSeries(const char *const NAME, const struct series *const series);
+static void queueInput(const enum input_type TYPE, const unsigned PLAYER, const int VALUE, const Uint64 TIME);
+static void recordSample(struct series *const series, const Uint64 DURATION, const Uint64 FREQUENCY);
+static unsigned runArenaBenchmark(const unsigned BALLS, const unsigned long TICKS);
+static unsigned runExport(const struct options *const options);
+static unsigned runHeadless(const unsigned long TICKS);
+static unsigned runMatches(const unsigned MATCHES, const unsigned THREADS, const uint64_t SEED, const unsigned BOT_LEVEL);
+static unsigned runNetHeadless(const struct options *const options);
+static unsigned runReplay(const char *const PATH, const unsigned long SEEK);
+static unsigned sendInputs(void);
+static void *simulate(void *const argument);
+static void sleepUntil(const Uint64 DEADLINE, const Uint64 FREQUENCY);
+static unsigned startSimulation(void);
+static void stopSimulation(void);
+static unsigned tickWorld(void);
+static void toggleHud(void);
+
+int main(int argc, char *argv[]){
+        const Uint64 START = SDL_GetPerformanceCounter();
+
+        struct options options = { .bundle = BUNDLE_PATH, .fps = FRAME_RATE, .seed = time(NULL) };
+        if(parseArgs(argc, argv, &options)){
+                fprintf(stderr, "Usage: %s [--balls N] [--bot LEVEL] [--bundle FILE] [--export FILE [--export-format y4m|rgb]] [--level FILE] [--fps N | --vsync] [--software] [--render-delay MS] [--stats] [--profile FILE] [--seed N] [--record FILE | --replay FILE [--seek N]] [--peer HOST:PORT --port PORT --player 1|2 [--latency MS] [--jitter MS] [--loss PERCENT]] [--headless --ticks N | --headless --matches N [--threads N]]\n", argv[0]);
+                return 1;
+        }
+        seedWorld(&world, options.seed);
+        bot_level = options.bot;
+        if(bot_level){
+                initBot(&bot, bot_level, options.seed ^ MATCH_BOT_SEED);
+        }
+        if(options.level){
+                if(loadLevel(options.level, &field)){
+                        fprintf(stderr, "*** Error: Unable to load level\n");
+                        return 1;
+                }
+                world.field = &field;
+                scene.field = &field;
+        }
+
+        if(options.headless && options.peer){
+                if(runNetHeadless(&options)){
+                        fprintf(stderr, "*** Error: Unable to run headless network game\n");
+                        goto err_runHeadless;
+                }
+        }else if(options.headless && options.export){
+                if(runExport(&options)){
+                        fprintf(stderr, "*** Error: Unable to export video\n");
+                        goto err_runHeadless;
+                }
+        }else if(options.headless && options.replay){
+                if(runReplay(options.replay, options.seek)){
+                        fprintf(stderr, "*** Error: Unable to play back replay\n");
+                        goto err_runHeadless;
+                }
+        }else if(options.headless && options.matches){
+                if(runMatches(options.matches, options.threads ? options.threads : onlineProcessors(), options.seed, options.bot)){
+                        fprintf(stderr, "*** Error: Unable to run batch of matches\n");
+                        goto err_runHeadless;
+                }
+        }else if(options.headless && options.balls){
+                if(runArenaBenchmark(options.balls, options.ticks)){
+                        fprintf(stderr, "*** Error: Unable to run multi-ball benchmark\n");
+                        goto err_runHeadless;
+                }
+        }else if(options.headless){
+                if(runHeadless(options.ticks)){
+                        fprintf(stderr, "*** Error: Unable to run headless simulation\n");
+                        goto err_runHeadless;
+                }
+        }
+        if(options.headless){
+                freeField(&field);
+                return 0;
+        }
 
         SDL_Window *window;
         SDL_Renderer *renderer;
-        if(initDisplay(&window, &renderer)){
+        if(initDisplay(&window, &renderer, &options)){
                 fprintf(stderr, "*** Error: Unable to initialize display\n");
-                return 1;
+                goto err_initDisplay;
         }
 
-        if(loadFiles(renderer)){
+        /* The sprites are loaded while a placeholder frame is shown, so
+         * that the window has something in it at once */
+        struct loader loader;
+        if(startLoader(&loader, options.bundle, MEDIA_DIR)){
                 fprintf(stderr, "*** Error: Unable to load files\n");
                 goto err_loadFiles;
         }
+        struct world preview = world;
+        initWorld(&preview, options.seed);
+        if(drawPlaceholder(renderer, &preview)){
+                fprintf(stderr, "*** Warning: Unable to draw placeholder frame\n");
+        }
+        SDL_RenderPresent(renderer);
+        const Uint64 FIRST_FRAME = SDL_GetPerformanceCounter() - START;
+        while(!loaderDone(&loader)){
+                SDL_PumpEvents();
+                SDL_Delay(1);
+        }
+        const unsigned LOAD_FAILED = finishLoader(&loader) || loadFiles(renderer, &loader);
+        freeLoader(&loader);
+        if(LOAD_FAILED){
+                fprintf(stderr, "*** Error: Unable to load files\n");
+                goto err_loadFiles;
+        }
+        if(initLayer(&layer, renderer)){
+                fprintf(stderr, "*** Warning: Unable to cache static layer; drawing it every frame\n");
+        }else{
+                scene.layer = &layer;
+        }
+        initWorld(&world, options.seed);
+
+        if(options.record){
+                startRecording(&replay, &world, options.seed);
+                recording = 1;
+        }else if(options.replay){
+                if(loadReplay(options.replay, &replay)){
+                        fprintf(stderr, "*** Error: Unable to load replay\n");
+                        goto err_loadReplay;
+                }
+                if(initPlayback(&playback, &replay)){
+                        fprintf(stderr, "*** Error: Unable to set up replay playback\n");
+                        goto err_initPlayback;
+                }
+                seekPlayback(&playback, options.seek);
+                world = playback.world;
+                replaying = 1;
+        }else if(options.peer && connectPeer(&options)){
+                fprintf(stderr, "*** Error: Unable to connect to peer\n");
+                goto err_connectPeer;
+        }
+
+        arena_kernel = bestArenaKernel();
+        if(options.balls && initArena(&arena, options.balls, &world.ball, ARENA_SEED)){
+                fprintf(stderr, "*** Error: Unable to set up multi-ball arena\n");
+                goto err_initArena;
+        }
+
+        if(initSnapshots(&snapshots, arena.count, field.count)){
+                fprintf(stderr, "*** Error: Unable to set up snapshots\n");
+                goto err_initSnapshots;
+        }
+        shown_arena = (struct arena){ .count = arena.count, .w = arena.w, .h = arena.h };
+
+        initProfile(&profile);
+        profiling = options.profile != NULL;
+        profile.enabled = profiling;
+
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 TICK_PERIOD = FREQUENCY/TICK_RATE;
+        const Uint64 FRAME_PERIOD = options.vsync ? 0 : FREQUENCY/options.fps;
+        struct frame_stats stats = { .cpu_start = clock(), .first_frame = FIRST_FRAME };
+        if(startSimulation()){
+                fprintf(stderr, "*** Error: Unable to start simulation\n");
+                goto err_startSimulation;
+        }
 
         unsigned running = 1;
-        Uint32 lastFrame = 0;
+        unsigned idle = 0;
+        Uint64 shown_input = 0;
+        Uint64 lastFrame = SDL_GetPerformanceCounter();
+        Uint64 nextFrame = lastFrame;
         do{
-                Uint32 currFrame = SDL_GetTicks();
-                if(currFrame - lastFrame > 33){
-                        lastFrame = currFrame;
-
-                        if(drawWorld(renderer)){
-                                fprintf(stderr, "*** Error: Unable to draw world\n");
-                                goto err_drawWorld;
+                startFrame(&profile);
+                handleEvents(&running, &idle);
+                if(__atomic_load_n(&sim_failed, __ATOMIC_ACQUIRE)){
+                        fprintf(stderr, "*** Error: Unable to process world\n");
+                        goto err_simulate;
+                }
+                markPhase(&profile, PROFILE_EVENTS);
+
+                /* A networked game keeps running while hidden, or the peer
+                 * would stall waiting for our inputs */
+                if(idle && !networked){
+                        __atomic_store_n(&sim_paused, 1, __ATOMIC_RELEASE);
+                        if(!SDL_WaitEvent(NULL)){
+                                fprintf(stderr, "*** Error: Unable to wait for events: %s\n", SDL_GetError());
+                                goto err_waitEvent;
                         }
+                        __atomic_store_n(&sim_paused, 0, __ATOMIC_RELEASE);
+                        lastFrame = SDL_GetPerformanceCounter();
+                        nextFrame = lastFrame;
+                        continue;
+                }
 
-                        if(handleEvents(&running, renderer)){
-                                fprintf(stderr, "*** Error: Unable to handle events\n");
-                                goto err_handleEvents;
-                        }
-                        if(processWorld(renderer)){
-                                fprintf(stderr, "*** Error: Unable to process world\n");
-                                goto err_processWorld;
+                const Uint64 CURR_FRAME = SDL_GetPerformanceCounter();
+                recordSample(&stats.interval, CURR_FRAME - lastFrame, FREQUENCY);
+                lastFrame = CURR_FRAME;
+
+                /* Frames are drawn a tick behind the simulation, so that the
+                 * ball and paddles glide between the last two ticks */
+                const struct snapshot *const SNAPSHOT = latestSnapshot(&snapshots);
+                const double ALPHA = (CURR_FRAME > SNAPSHOT->time) ? (double)(CURR_FRAME - SNAPSHOT->time)/TICK_PERIOD : 0;
+                interpolateSnapshot(SNAPSHOT, (ALPHA < 1) ? ALPHA : 1, &shown);
+                shown_arena.x = SNAPSHOT->x;
+                shown_arena.y = SNAPSHOT->y;
+                scene.alive = SNAPSHOT->alive;
+                scene.field_version = SNAPSHOT->field_version;
+                markPhase(&profile, PROFILE_SIMULATE);
+
+                const Uint64 DRAW_START = SDL_GetPerformanceCounter();
+                if(drawWorld(renderer, &scene)){
+                        fprintf(stderr, "*** Error: Unable to draw world\n");
+                        goto err_drawWorld;
+                }
+                markPhase(&profile, PROFILE_DRAW);
+                SDL_RenderPresent(renderer);
+                if(options.render_delay){
+                        SDL_Delay(options.render_delay);
+                }
+                markPhase(&profile, PROFILE_PRESENT);
+                const Uint64 DRAW_END = SDL_GetPerformanceCounter();
+                recordSample(&stats.draw, DRAW_END - DRAW_START, FREQUENCY);
+                if(SNAPSHOT->input_time > shown_input){
+                        recordSample(&stats.latency, DRAW_END - SNAPSHOT->input_time, FREQUENCY);
+                        shown_input = SNAPSHOT->input_time;
+                }
+                if(!stats.interactive){
+                        stats.interactive = DRAW_END - START;
+                }
+
+                if(FRAME_PERIOD){
+                        nextFrame += FRAME_PERIOD;
+                        if(nextFrame < CURR_FRAME){
+                                nextFrame = CURR_FRAME;
                         }
+                        sleepUntil(nextFrame, FREQUENCY);
                 }
+                markPhase(&profile, PROFILE_SLEEP);
+                endFrame(&profile);
         }while(running);
 
+        stopSimulation();
+        if(options.stats){
+                printFrameStats(&stats);
+        }
+        if(networked){
+                printNetStats(stats.interval.count);
+                closeNet(&net);
+        }
+        const unsigned PROFILE_FAILED = options.profile && writeProfile(&profile, options.profile);
+
+        const unsigned SAVE_FAILED = recording && saveReplay(&replay, options.record, &world);
+
+        freeSnapshots(&snapshots);
+        freeArena(&arena);
+        freePlayback(&playback);
+        freeReplay(&replay);
+        freeLayer(&layer);
         freeFiles();
         closeDisplay(window, renderer);
+        freeField(&field);
 
-        return 0;
+        return SAVE_FAILED || PROFILE_FAILED;
 
-err_processWorld:
-err_handleEvents:
 err_drawWorld:
+err_waitEvent:
+err_simulate:
+        stopSimulation();
+err_startSimulation:
+        freeSnapshots(&snapshots);
+err_initSnapshots:
+        freeArena(&arena);
+err_initArena:
+        if(networked){
+                closeNet(&net);
+        }
+err_connectPeer:
+        freePlayback(&playback);
+err_initPlayback:
+        freeReplay(&replay);
+err_loadReplay:
+        freeLayer(&layer);
         freeFiles();
 err_loadFiles:
         closeDisplay(window, renderer);
+err_initDisplay:
+err_runHeadless:
+        freeField(&field);
         return 1;
 }
 
-static void closeDisplay(SDL_Window *const window, SDL_Renderer *const renderer){
-        TTF_Quit();
+/* Applies every queued input that happened no later than DEADLINE, and
+ * reports whether any moved the ball or paddles discontinuously */
+static unsigned applyInputs(const Uint64 DEADLINE){
+        unsigned jumped = 0;
+        const struct input_event *event;
+        while((event = peekInput(&inputs, DEADLINE))){
+                switch(event->type){
+                        case INPUT_PADDLE:
+                                ((event->player == 1) ? &world.player1 : &world.player2)->avatar.y_vel = event->value;
+                                last_input = event->time;
+                                break;
+                        case INPUT_RESET:
+                                resetWorld(&world);
+                                if(recording){
+                                        markReset(&replay);
+                                }
+                                jumped = 1;
+                                break;
+                        case INPUT_SEEK:
+                                seekPlayback(&playback, (event->value < 0 && playback.tick < (uint64_t)-event->value) ? 0 : playback.tick + event->value);
+                                world = playback.world;
+                                jumped = 1;
+                                break;
+                }
+                popInput(&inputs);
+        }
 
+        return jumped;
+}
+
+static void bundleAtlas(const struct bundle_header *const HEADER, struct atlas *const atlas){
+        atlas->w = HEADER->w;
+        atlas->h = HEADER->h;
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                const struct bundle_rect *const RECT = &HEADER->rects[i];
+                atlas->rects[i] = (SDL_Rect){ .x = RECT->x, .y = RECT->y, .w = RECT->w, .h = RECT->h };
+        }
+}
+
+static void closeDisplay(SDL_Window *const window, SDL_Renderer *const renderer){
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
 }
 
-static unsigned drawWorld(SDL_Renderer *const renderer){
-        if(SDL_RenderClear(renderer) < 0){
-                fprintf(stderr, "*** Error: Unable to clear renderer: %s\n", SDL_GetError());
+/* Player 1 picks the seed and keeps offering it until player 2 answers;
+ * both sides must then have built exactly the same starting world */
+static unsigned connectPeer(const struct options *const options){
+        if(openNet(&net, options->port, options->peer, &options->shim)){
                 return 1;
         }
 
-        if(SDL_RenderCopy(renderer, background.texture, NULL, &background.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw background: %s\n", SDL_GetError());
-                return 1;
-        }
-
-        if(SDL_RenderCopy(renderer, ball.sprite.texture, NULL, &ball.sprite.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw ball: %s\n", SDL_GetError());
-                return 1;
+        unsigned char packet[NET_MAX_PACKET];
+        const size_t HELLO_SIZE = writeHello(packet, options->seed, hashWorld(&world));
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 DEADLINE = SDL_GetPerformanceCounter() + FREQUENCY*CONNECT_TIMEOUT/1000;
+        unsigned connected = 0;
+        if(options->player == 1){
+                initRollback(&rollback, &world, 0);
         }
+        while(!connected){
+                if(SDL_GetPerformanceCounter() > DEADLINE){
+                        fprintf(stderr, "*** Error: Timed out waiting for peer \"%s\"\n", options->peer);
+                        goto err_timeout;
+                }
+                if(options->player == 1 && sendNet(&net, packet, HELLO_SIZE)){
+                        goto err_send;
+                }
+                if(flushNet(&net) || waitNet(&net, HELLO_INTERVAL)){
+                        goto err_wait;
+                }
 
-        if(SDL_RenderCopy(renderer, player1.avatar.sprite.texture, NULL, &player1.avatar.sprite.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw player 1: %s\n", SDL_GetError());
-                return 1;
-        }
+                unsigned char reply[NET_MAX_PACKET];
+                size_t size;
+                while(!connected && !receiveNet(&net, reply, sizeof(reply), &size) && size){
+                        uint64_t seed;
+                        uint64_t hash;
+                        if(options->player == 1){
+                                connected = !readHello(reply, size, &seed, &hash) || !readInputs(&rollback, reply, size);
+                                continue;
+                        }
+                        if(readHello(reply, size, &seed, &hash)){
+                                continue;
+                        }
 
-        if(SDL_RenderCopy(renderer, player2.avatar.sprite.texture, NULL, &player2.avatar.sprite.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw player 2: %s\n", SDL_GetError());
-                return 1;
+                        initWorld(&world, seed);
+                        if(hashWorld(&world) != hash){
+                                fprintf(stderr, "*** Error: Peer started from a different world; are the same sprites in use?\n");
+                                goto err_mismatch;
+                        }
+                        initRollback(&rollback, &world, 1);
+                        if(sendNet(&net, reply, size) || flushNet(&net)){
+                                goto err_send;
+                        }
+                        connected = 1;
+                }
         }
 
-        if(SDL_RenderCopy(renderer, player1.score_display.texture, NULL, &player1.score_display.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw player 1 score: %s\n", SDL_GetError());
-                return 1;
-        }
+        networked = 1;
+        last_heard = SDL_GetPerformanceCounter();
 
-        if(SDL_RenderCopy(renderer, player2.score_display.texture, NULL, &player2.score_display.dimensions)){
-                fprintf(stderr, "*** Error: Unable to draw player 2 score: %s\n", SDL_GetError());
-                return 1;
-        }
+        return 0;
 
-        SDL_RenderPresent(renderer);
+err_mismatch:
+err_wait:
+err_send:
+err_timeout:
+        closeNet(&net);
+        return 1;
+}
 
-        return 0;
+static void fillSnapshot(struct snapshot *const snapshot, const Uint64 TIME){
+        snapshot->world = world;
+        snapshot->time = TIME;
+        snapshot->input_time = last_input;
+        if(arena.count){
+                memcpy(snapshot->x, arena.x, sizeof(*arena.x)*arena.count);
+                memcpy(snapshot->y, arena.y, sizeof(*arena.y)*arena.count);
+        }
+        if(field.count){
+                memcpy(snapshot->alive, field.alive, sizeof(*field.alive)*((field.count + 63)/64));
+                snapshot->field_version = field.version;
+        }
 }
 
 static void freeFiles(void){
-        SDL_DestroyTexture(player2.score_display.texture);
-        SDL_DestroyTexture(player1.score_display.texture);
+        SDL_DestroyTexture(atlas_texture);
+}
 
-        SDL_DestroyTexture(player2.avatar.sprite.texture);
-        SDL_DestroyTexture(player1.avatar.sprite.texture);
-        SDL_DestroyTexture(ball.sprite.texture);
-        SDL_DestroyTexture(background.texture);
+/* Converts an event timestamp, in milliseconds, to the performance
+ * counter, given a reading of both clocks taken at the same moment */
+static Uint64 eventTime(const Uint32 TIMESTAMP, const Uint64 NOW, const Uint32 NOW_MS, const Uint64 FREQUENCY){
+        if(!TIMESTAMP || SDL_TICKS_PASSED(TIMESTAMP, NOW_MS)){
+                return NOW;
+        }
 
-        TTF_CloseFont(font);
+        const Uint64 AGE = (Uint64)(NOW_MS - TIMESTAMP)*FREQUENCY/1000;
+        return (AGE < NOW) ? NOW - AGE : NOW;
 }
 
-static unsigned handleEvents(unsigned *const running, SDL_Renderer *const renderer){
+/* The world belongs to the simulation thread, so keys that change it
+ * are queued for it along with the time they were pressed */
+static void handleEvents(unsigned *const running, unsigned *const idle){
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 NOW = SDL_GetPerformanceCounter();
+        const Uint32 NOW_MS = SDL_GetTicks();
+
         SDL_Event event;
         while(SDL_PollEvent(&event)){
+                const Uint64 TIME = eventTime(event.common.timestamp, NOW, NOW_MS, FREQUENCY);
                 switch(event.type){
                         case SDL_KEYDOWN:
+                                if(replaying){
+                                        handleReplayKey(event.key.keysym.sym, TIME, running);
+                                        break;
+                                }
                                 switch(event.key.keysym.sym){
                                         case SDLK_s:
-                                                player1.avatar.y_vel = 10;
+                                                queueInput(INPUT_PADDLE, 1, 10, TIME);
                                                 break;
                                         case SDLK_DOWN:
-                                                player2.avatar.y_vel = 10;
+                                                if(!bot_level){
+                                                        queueInput(INPUT_PADDLE, 2, 10, TIME);
+                                                }
                                                 break;
                                         case SDLK_ESCAPE:
                                                 *running = 0;
                                                 break;
+                                        case SDLK_F3:
+                                                toggleHud();
+                                                break;
                                         case SDLK_RETURN:
-                                                if(newGame(renderer)){
-                                                        fprintf(stderr, "*** Error: Unable to start new game\n");
-                                                        return 1;
+                                                if(networked){
+                                                        break;
                                                 }
+                                                queueInput(INPUT_RESET, 0, 0, TIME);
                                                 break;
                                         case SDLK_UP:
-                                                player2.avatar.y_vel = -10;
+                                                if(!bot_level){
+                                                        queueInput(INPUT_PADDLE, 2, -10, TIME);
+                                                }
                                                 break;
                                         case SDLK_w:
-                                                player1.avatar.y_vel = -10;
+                                                queueInput(INPUT_PADDLE, 1, -10, TIME);
                                                 break;
                                         default:
                                                 break;
                                 }
                                 break;
                         case SDL_KEYUP:
+                                if(replaying){
+                                        break;
+                                }
                                 switch(event.key.keysym.sym){
                                         case SDLK_DOWN:
                                         case SDLK_UP:
-                                                player2.avatar.y_vel = 0;
+                                                if(!bot_level){
+                                                        queueInput(INPUT_PADDLE, 2, 0, TIME);
+                                                }
                                                 break;
                                         case SDLK_s:
                                         case SDLK_w:
-                                                player1.avatar.y_vel = 0;
+                                                queueInput(INPUT_PADDLE, 1, 0, TIME);
                                                 break;
                                         default:
                                                 break;
                                 }
                                 break;
+                        case SDL_WINDOWEVENT:
+                                switch(event.window.event){
+                                        case SDL_WINDOWEVENT_HIDDEN:
+                                        case SDL_WINDOWEVENT_MINIMIZED:
+                                                *idle = 1;
+                                                break;
+                                        case SDL_WINDOWEVENT_SHOWN:
+                                        case SDL_WINDOWEVENT_RESTORED:
+                                                *idle = 0;
+                                                break;
+                                        default:
+                                                break;
+                                }
+                                break;
+                        /* the contents of target textures are lost */
+                        case SDL_RENDER_TARGETS_RESET:
+                        case SDL_RENDER_DEVICE_RESET:
+                                layer.valid = 0;
+                                break;
                         case SDL_QUIT:
                                 *running = 0;
                                 break;
@@ -238,11 +692,30 @@ static unsigned handleEvents(unsigned *const running, SDL_Renderer *const render
                                 break;
                 }
         }
+}
 
-        return 0;
+/* During playback the paddles are driven by the replay, and the arrow
+ * keys instead seek backward and forward through it */
+static void handleReplayKey(const SDL_Keycode KEY, const Uint64 TIME, unsigned *const running){
+        switch(KEY){
+                case SDLK_ESCAPE:
+                        *running = 0;
+                        break;
+                case SDLK_F3:
+                        toggleHud();
+                        break;
+                case SDLK_LEFT:
+                        queueInput(INPUT_SEEK, 0, -SEEK_TICKS, TIME);
+                        break;
+                case SDLK_RIGHT:
+                        queueInput(INPUT_SEEK, 0, SEEK_TICKS, TIME);
+                        break;
+                default:
+                        break;
+        }
 }
 
-static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const renderer){
+static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const renderer, const struct options *const options){
         if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0){
                 fprintf(stderr, "*** Error: Unable to initialize SDL: %s\n", SDL_GetError());
                 return 1;
@@ -253,6 +726,10 @@ static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const rend
                 goto err_show_cursor;
         }
 
+        SDL_SetHint(SDL_HINT_RENDER_VSYNC, options->vsync ? "1" : "0");
+        if(options->software){
+                SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        }
         if(SDL_CreateWindowAndRenderer(0, 0, SDL_WINDOW_FULLSCREEN_DESKTOP, window, renderer) < 0){
                 fprintf(stderr, "*** Error: Unable to create window and default renderer: %s\n", SDL_GetError());
                 goto err_create_wind_rend;
@@ -268,14 +745,8 @@ static unsigned initDisplay(SDL_Window **const window, SDL_Renderer **const rend
                 goto err_set_rend_draw_color;
         }
 
-        if(TTF_Init()){
-                fprintf(stderr, "*** Error: Unable to initialize TrueType font support: %s\n", TTF_GetError());
-                goto err_ttf_init;
-        }
-
         return 0;
 
-err_ttf_init:
 err_set_rend_draw_color:
 err_set_logical_size:
         SDL_DestroyRenderer(*renderer);
@@ -286,220 +757,938 @@ err_show_cursor:
         return 1;
 }
 
-static unsigned loadFiles(SDL_Renderer *const renderer){
-        char *font_path = "media/fonts/boingium.ttf";
-        font = TTF_OpenFont(font_path, 32);
-        if(!font){
-                fprintf(stderr, "*** Error: Unable to open font file \"%s\": %s\n", font_path, TTF_GetError());
+static unsigned loadBundle(struct bundle *const bundle, SDL_Renderer *const renderer){
+        const struct bundle_header *const HEADER = bundle->header;
+
+        atlas_texture = SDL_CreateTexture(renderer, HEADER->format, SDL_TEXTUREACCESS_STATIC, HEADER->w, HEADER->h);
+        if(!atlas_texture){
+                fprintf(stderr, "*** Error: Unable to create atlas texture: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        if(SDL_UpdateTexture(atlas_texture, NULL, bundle->pixels, HEADER->pitch)){
+                fprintf(stderr, "*** Error: Unable to upload atlas texture: %s\n", SDL_GetError());
+                goto err_update_texture;
+        }
+
+        if(SDL_SetTextureBlendMode(atlas_texture, SDL_BLENDMODE_BLEND)){
+                fprintf(stderr, "*** Error: Unable to set atlas texture blend mode: %s\n", SDL_GetError());
+                goto err_set_blend_mode;
+        }
+
+        bundleAtlas(HEADER, &atlas);
+
+        return 0;
+
+err_set_blend_mode:
+err_update_texture:
+        SDL_DestroyTexture(atlas_texture);
+        return 1;
+}
+
+/* The canvas takes the atlas's pixels rather than a texture; they come
+ * from the bundle when there is one, as with loadFiles() */
+static unsigned loadCanvas(struct canvas *const canvas, const char *const BUNDLE){
+        const enum canvas_kernel KERNEL = bestCanvasKernel();
+
+        struct bundle bundle;
+        if(!openBundle(BUNDLE, &bundle)){
+                if(bundle.header->format != SDL_PIXELFORMAT_ARGB8888){
+                        fprintf(stderr, "*** Error: Bundle \"%s\" is not in ARGB8888 format\n", BUNDLE);
+                        closeBundle(&bundle);
+                        return 1;
+                }
+                struct atlas bundled;
+                bundleAtlas(bundle.header, &bundled);
+                const unsigned FAILED = initCanvas(canvas, &bundled, bundle.pixels, bundle.header->pitch, KERNEL);
+                closeBundle(&bundle);
+                return FAILED;
+        }
+
+        SDL_Surface *surfaces[ATLAS_ENTRIES] = { NULL };
+        if(loadAtlasSurfaces(MEDIA_DIR, surfaces)){
+                fprintf(stderr, "*** Error: Unable to load sprites\n");
+                goto err_load_surfaces;
+        }
+
+        struct atlas packed;
+        SDL_Surface *const atlas_surface = packAtlas(surfaces, &packed);
+        if(!atlas_surface){
+                fprintf(stderr, "*** Error: Unable to pack sprite atlas\n");
+                goto err_pack_atlas;
+        }
+
+        const unsigned FAILED = initCanvas(canvas, &packed, atlas_surface->pixels, atlas_surface->pitch, KERNEL);
+        SDL_FreeSurface(atlas_surface);
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+
+        return FAILED;
+
+err_pack_atlas:
+err_load_surfaces:
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+        return 1;
+}
+
+/* Uploads the atlas the loader has finished reading */
+static unsigned loadFiles(SDL_Renderer *const renderer, struct loader *const loader){
+        if(loader->bundled){
+                if(loadBundle(&loader->bundle, renderer)){
+                        fprintf(stderr, "*** Error: Unable to load bundle \"%s\"\n", loader->bundle_path);
+                        return 1;
+                }
+        }else if(loadMedia(renderer, loader)){
+                fprintf(stderr, "*** Error: Unable to load media files\n");
+                return 1;
+        }
+        initBatch(&batch, renderer, atlas_texture, atlas.w, atlas.h);
+
+        world.ball.box.w = atlas.rects[ATLAS_BALL].w;
+        world.ball.box.h = atlas.rects[ATLAS_BALL].h;
+        world.player1.avatar.box.w = atlas.rects[ATLAS_PADDLE1].w;
+        world.player1.avatar.box.h = atlas.rects[ATLAS_PADDLE1].h;
+        world.player2.avatar.box.w = atlas.rects[ATLAS_PADDLE2].w;
+        world.player2.avatar.box.h = atlas.rects[ATLAS_PADDLE2].h;
+
+        return 0;
+}
+
+static unsigned loadMedia(SDL_Renderer *const renderer, const struct loader *const LOADER){
+        atlas_texture = SDL_CreateTextureFromSurface(renderer, LOADER->surface);
+        if(!atlas_texture){
+                fprintf(stderr, "*** Error: Unable to create texture from sprite atlas: %s\n", SDL_GetError());
+                return 1;
+        }
+        atlas = LOADER->atlas;
+
+        return 0;
+}
+
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options){
+        for(int i = 1; i < argc; i++){
+                unsigned long number;
+                if(!strcmp(argv[i], "--balls") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1u << 24, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of balls \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->balls = number;
+                }else if(!strcmp(argv[i], "--bot") && i + 1 < argc){
+                        if(parseNumber(argv[++i], BOT_LEVELS, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid bot level \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->bot = number;
+                }else if(!strcmp(argv[i], "--bundle") && i + 1 < argc){
+                        options->bundle = argv[++i];
+                }else if(!strcmp(argv[i], "--export") && i + 1 < argc){
+                        options->export = argv[++i];
+                }else if(!strcmp(argv[i], "--export-format") && i + 1 < argc){
+                        i++;
+                        unsigned format = 0;
+                        while(format < VIDEO_FORMATS && strcmp(argv[i], VIDEO_FORMAT_NAMES[format])){
+                                format++;
+                        }
+                        if(format == VIDEO_FORMATS){
+                                fprintf(stderr, "*** Error: Invalid video format \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->export_format = format;
+                }else if(!strcmp(argv[i], "--headless")){
+                        options->headless = 1;
+                }else if(!strcmp(argv[i], "--jitter") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 10000, &number)){
+                                fprintf(stderr, "*** Error: Invalid jitter \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->shim.jitter = number;
+                }else if(!strcmp(argv[i], "--latency") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 10000, &number)){
+                                fprintf(stderr, "*** Error: Invalid latency \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->shim.latency = number;
+                }else if(!strcmp(argv[i], "--level") && i + 1 < argc){
+                        options->level = argv[++i];
+                }else if(!strcmp(argv[i], "--loss") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 100, &number)){
+                                fprintf(stderr, "*** Error: Invalid packet loss \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->shim.loss = number;
+                }else if(!strcmp(argv[i], "--fps") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1000, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid frame rate \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->fps = number;
+                }else if(!strcmp(argv[i], "--matches") && i + 1 < argc){
+                        if(parseNumber(argv[++i], UINT_MAX, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of matches \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->matches = number;
+                }else if(!strcmp(argv[i], "--peer") && i + 1 < argc){
+                        options->peer = argv[++i];
+                }else if(!strcmp(argv[i], "--player") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 2, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid player \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->player = number;
+                }else if(!strcmp(argv[i], "--port") && i + 1 < argc){
+                        options->port = argv[++i];
+                }else if(!strcmp(argv[i], "--profile") && i + 1 < argc){
+                        options->profile = argv[++i];
+                }else if(!strcmp(argv[i], "--record") && i + 1 < argc){
+                        options->record = argv[++i];
+                }else if(!strcmp(argv[i], "--render-delay") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 10000, &number)){
+                                fprintf(stderr, "*** Error: Invalid render delay \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->render_delay = number;
+                }else if(!strcmp(argv[i], "--replay") && i + 1 < argc){
+                        options->replay = argv[++i];
+                }else if(!strcmp(argv[i], "--seed") && i + 1 < argc){
+                        if(parseNumber(argv[++i], ULONG_MAX, &options->seed)){
+                                fprintf(stderr, "*** Error: Invalid seed \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                }else if(!strcmp(argv[i], "--seek") && i + 1 < argc){
+                        if(parseNumber(argv[++i], ULONG_MAX, &options->seek)){
+                                fprintf(stderr, "*** Error: Invalid tick \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                }else if(!strcmp(argv[i], "--software")){
+                        options->software = 1;
+                }else if(!strcmp(argv[i], "--stats")){
+                        options->stats = 1;
+                }else if(!strcmp(argv[i], "--threads") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1024, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of threads \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->threads = number;
+                }else if(!strcmp(argv[i], "--vsync")){
+                        options->vsync = 1;
+                }else if(!strcmp(argv[i], "--ticks") && i + 1 < argc){
+                        if(parseNumber(argv[++i], ULONG_MAX, &options->ticks) || !options->ticks){
+                                fprintf(stderr, "*** Error: Invalid number of ticks \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                }else{
+                        fprintf(stderr, "*** Error: Unknown option \"%s\"\n", argv[i]);
+                        return 1;
+                }
+        }
+
+        if(options->ticks && !options->headless){
+                fprintf(stderr, "*** Error: --ticks requires --headless\n");
+                return 1;
+        }
+        if(options->matches && !options->headless){
+                fprintf(stderr, "*** Error: --matches requires --headless\n");
+                return 1;
+        }
+        if(options->matches && (options->balls || options->ticks)){
+                fprintf(stderr, "*** Error: --matches cannot be combined with --balls or --ticks\n");
+                return 1;
+        }
+        if(options->threads && !options->matches){
+                fprintf(stderr, "*** Error: --threads requires --matches\n");
+                return 1;
+        }
+        if(options->record && (options->replay || options->headless || options->balls)){
+                fprintf(stderr, "*** Error: --record cannot be combined with --replay, --headless or --balls\n");
+                return 1;
+        }
+        if(options->replay && (options->balls || options->ticks || options->matches)){
+                fprintf(stderr, "*** Error: --replay cannot be combined with --balls, --ticks or --matches\n");
+                return 1;
+        }
+        if(options->profile && options->headless){
+                fprintf(stderr, "*** Error: --profile cannot be combined with --headless\n");
+                return 1;
+        }
+        if(options->seek && !options->replay){
+                fprintf(stderr, "*** Error: --seek requires --replay\n");
+                return 1;
+        }
+        if(options->peer && (!options->port || !options->player)){
+                fprintf(stderr, "*** Error: --peer requires --port and --player\n");
+                return 1;
+        }
+        if(!options->peer && (options->port || options->player || options->shim.latency || options->shim.jitter || options->shim.loss)){
+                fprintf(stderr, "*** Error: --port, --player, --latency, --jitter and --loss require --peer\n");
+                return 1;
+        }
+        if(options->peer && (options->balls || options->matches || options->record || options->replay)){
+                fprintf(stderr, "*** Error: --peer cannot be combined with --balls, --matches, --record or --replay\n");
+                return 1;
+        }
+        if(options->bot && (options->balls || options->peer || options->replay)){
+                fprintf(stderr, "*** Error: --bot cannot be combined with --balls, --peer or --replay\n");
+                return 1;
+        }
+        if(options->export && (!options->headless || !options->replay)){
+                fprintf(stderr, "*** Error: --export requires --headless and --replay\n");
+                return 1;
+        }
+        if(options->export_format && !options->export){
+                fprintf(stderr, "*** Error: --export-format requires --export\n");
+                return 1;
+        }
+        if(options->level && (options->balls || options->matches || options->peer || options->record || options->replay)){
+                fprintf(stderr, "*** Error: --level cannot be combined with --balls, --matches, --peer, --record or --replay\n");
                 return 1;
         }
 
-        if(updateScoreTexture(&player1, renderer)){
-                fprintf(stderr, "*** Error: Unable to update player 1 score texture\n");
-                goto err_updateScoreTexture;
+        return 0;
+}
+
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number){
+        char *end;
+        errno = 0;
+        *number = strtoul(STRING, &end, 10);
+
+        return end == STRING || *end != '\0' || errno || *number > MAX;
+}
+
+/* Player 2 answers every hello, in case its first answer was lost */
+static unsigned pollNet(void){
+        unsigned char packet[NET_MAX_PACKET];
+        size_t size;
+        for(;;){
+                if(receiveNet(&net, packet, sizeof(packet), &size)){
+                        return 1;
+                }
+                if(!size){
+                        break;
+                }
+
+                uint64_t seed;
+                uint64_t hash;
+                if(!readInputs(&rollback, packet, size)){
+                        last_heard = SDL_GetPerformanceCounter();
+                }else if(!readHello(packet, size, &seed, &hash) && rollback.player && sendNet(&net, packet, size)){
+                        return 1;
+                }
         }
-        if(updateScoreTexture(&player2, renderer)){
-                fprintf(stderr, "*** Error: Unable to update player 1 score texture\n");
-                goto err_updateScoreTexture;
+
+        return flushNet(&net);
+}
+
+static void printFrameStats(const struct frame_stats *const stats){
+        const double CPU_SECONDS = (double)(clock() - stats->cpu_start)/CLOCKS_PER_SEC;
+        const double WALL_SECONDS = stats->interval.mean*stats->interval.count/1000;
+
+        printf("Time to first frame: %.3f ms\n", 1000.0*stats->first_frame/SDL_GetPerformanceFrequency());
+        printf("Time to interactive: %.3f ms\n", 1000.0*stats->interactive/SDL_GetPerformanceFrequency());
+        printf("Frames: %lu\n", stats->interval.count);
+        printSeries("Frame time", &stats->interval);
+        printSeries("Draw time", &stats->draw);
+        if(tick_interval.count){
+                printSeries("Tick interval", &tick_interval);
+        }
+        if(stats->latency.count){
+                printSeries("Input to present", &stats->latency);
+        }
+        if(stats->draw.count){
+                printf("Draw calls per frame: %.2f\n", (double)batch.draw_calls/stats->draw.count);
+        }
+        if(WALL_SECONDS > 0){
+                printf("CPU usage: %.1f%%\n", 100*CPU_SECONDS/WALL_SECONDS);
         }
+}
 
-        if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG){
-                fprintf(stderr, "*** Error: Unable to initialize PNG image support: %s\n", IMG_GetError());
-                goto err_img_init;
+static void printNetStats(const unsigned long FRAMES){
+        printf("Rollbacks: %lu\n", rollback.rollbacks);
+        printf("Rollback depth: mean %.2f ticks, max %u ticks\n", rollback.rollbacks ? (double)rollback.resimulated/rollback.rollbacks : 0.0, rollback.max_depth);
+        if(FRAMES){
+                printf("Re-simulated ticks per frame: %.3f\n", (double)rollback.resimulated/FRAMES);
         }
+        printSeries("Re-simulation time", &resimulation);
+        printf("Stalls waiting for peer: %lu\n", stalled_frames);
+        printf("Packets sent: %lu, dropped by shim: %lu\n", net.sent, net.dropped);
+}
+
+static void printSeries(const char *const NAME, const struct series *const series){
+        const double STD_DEV = (series->count > 1) ? sqrt(series->m2/(series->count - 1)) : 0;
+
+        printf("%s: mean %.3f ms, std dev %.3f ms, max %.3f ms\n", NAME, series->mean, STD_DEV, series->max);
+}
 
-        if(loadSprite("media/images/background.png", &background, renderer)){
-                fprintf(stderr, "*** Error: Unable to load background sprite\n");
-                goto err_load_background;
+/* Should the simulation fall so far behind that the queue fills, the key
+ * is dropped rather than block the event loop */
+static void queueInput(const enum input_type TYPE, const unsigned PLAYER, const int VALUE, const Uint64 TIME){
+        const struct input_event EVENT = { .time = TIME, .type = TYPE, .player = PLAYER, .value = VALUE };
+
+        if(pushInput(&inputs, &EVENT)){
+                fprintf(stderr, "*** Warning: Input queue full; key dropped\n");
         }
-        background.dimensions.x = 0;
-        background.dimensions.y = 0;
+}
+
+/* Welford's online algorithm, so that no per-frame history is kept */
+static void recordSample(struct series *const series, const Uint64 DURATION, const Uint64 FREQUENCY){
+        const double MS = 1000.0*DURATION/FREQUENCY;
+        const double DELTA = MS - series->mean;
 
-        if(loadSprite("media/images/ball.png", &ball.sprite, renderer)){
-                fprintf(stderr, "*** Error: Unable to load ball sprite\n");
-                goto err_load_ball;
+        series->count++;
+        series->mean += DELTA/series->count;
+        series->m2 += DELTA*(MS - series->mean);
+        if(MS > series->max){
+                series->max = MS;
         }
-        resetBall();
+}
 
-        if(loadSprite("media/images/paddle1.png", &player1.avatar.sprite, renderer)){
-                fprintf(stderr, "*** Error: Unable to load player 1 sprite\n");
-                goto err_load_player1;
+/* Steps the same arena with every kernel the CPU supports, checking that
+ * each one ends in exactly the state the scalar kernel does */
+static unsigned runArenaBenchmark(const unsigned BALLS, const unsigned long TICKS){
+        if(!TICKS){
+                fprintf(stderr, "*** Error: Number of ticks not specified\n");
+                return 1;
         }
-        player1.avatar.sprite.dimensions.x = (2*player1.avatar.sprite.dimensions.w > WIDTH) ? 0 : player1.avatar.sprite.dimensions.w;
-        player1.avatar.sprite.dimensions.y = (HEIGHT - player1.avatar.sprite.dimensions.h)/2;
 
-        if(loadSprite("media/images/paddle2.png", &player2.avatar.sprite, renderer)){
-                fprintf(stderr, "*** Error: Unable to load player 2 sprite\n");
-                goto err_load_player2;
+        placePaddles(&world);
+
+        struct arena reference = { .count = 0 };
+        struct world reference_world = world;
+        printf("Balls: %u\n", BALLS);
+        printf("Ticks: %lu\n", TICKS);
+        for(enum arena_kernel kernel = ARENA_SCALAR; kernel <= bestArenaKernel(); kernel++){
+                struct world bench_world = world;
+                struct arena bench;
+                if(initArena(&bench, BALLS, &bench_world.ball, ARENA_SEED)){
+                        fprintf(stderr, "*** Error: Unable to set up multi-ball arena\n");
+                        goto err_initArena;
+                }
+
+                const Uint64 START = SDL_GetPerformanceCounter();
+                for(unsigned long i = 0; i < TICKS; i++){
+                        if(stepArena(&bench, &bench_world, kernel)){
+                                freeArena(&bench);
+                                goto err_stepArena;
+                        }
+                }
+                const Uint64 END = SDL_GetPerformanceCounter();
+
+                const double SECONDS = (double)(END - START)/SDL_GetPerformanceFrequency();
+                printf("%s: %.0f balls per second\n", ARENA_KERNEL_NAMES[kernel], (double)BALLS*TICKS/SECONDS);
+
+                if(kernel == ARENA_SCALAR){
+                        reference = bench;
+                        reference_world = bench_world;
+                        continue;
+                }
+
+                const unsigned MISMATCH = memcmp(bench.x, reference.x, 4*sizeof(*bench.x)*BALLS) || bench.rng != reference.rng
+                                          || bench_world.player1.score != reference_world.player1.score || bench_world.player2.score != reference_world.player2.score;
+                freeArena(&bench);
+                if(MISMATCH){
+                        fprintf(stderr, "*** Error: The %s kernel disagrees with the scalar kernel\n", ARENA_KERNEL_NAMES[kernel]);
+                        goto err_mismatch;
+                }
         }
-        player2.avatar.sprite.dimensions.x = (WIDTH < 2*player2.avatar.sprite.dimensions.w) ? 0 : WIDTH - 2*player2.avatar.sprite.dimensions.w;
-        player2.avatar.sprite.dimensions.y = (HEIGHT - player2.avatar.sprite.dimensions.h)/2;
+        printf("Final score: %u - %u\n", reference_world.player1.score, reference_world.player2.score);
 
-        IMG_Quit();
+        freeArena(&reference);
         return 0;
 
-err_load_player2:
-        SDL_DestroyTexture(player1.avatar.sprite.texture);
-err_load_player1:
-        SDL_DestroyTexture(ball.sprite.texture);
-err_load_ball:
-        SDL_DestroyTexture(background.texture);
-err_load_background:
-        IMG_Quit();
-err_img_init:
-err_updateScoreTexture:
-        TTF_CloseFont(font);
+err_mismatch:
+err_stepArena:
+        freeArena(&reference);
+err_initArena:
         return 1;
 }
 
-static unsigned loadSprite(const char *const PATH, struct sprite *const sprite, SDL_Renderer *const renderer){
-        SDL_Surface *surface = IMG_Load(PATH);
-        if(!surface){
-                fprintf(stderr, "*** Error: Unable to load \"%s\": %s\n", PATH, IMG_GetError());
+/* Draws every tick of a recording from --seek onward into a canvas and
+ * streams the frames out, without a display or SDL's video subsystem.
+ * The report goes to stderr when the video goes to stdout. */
+static unsigned runExport(const struct options *const options){
+        FILE *const report = strcmp(options->export, VIDEO_STDOUT) ? stdout : stderr;
+
+        struct replay recorded;
+        if(loadReplay(options->replay, &recorded)){
+                fprintf(stderr, "*** Error: Unable to load replay\n");
                 return 1;
         }
-        sprite->dimensions.w = (surface->w > WIDTH) ? WIDTH : surface->w;
-        sprite->dimensions.h = (surface->h > HEIGHT) ? HEIGHT : surface->h;
-        sprite->texture = SDL_CreateTextureFromSurface(renderer, surface);
-        if(!sprite->texture){
-                fprintf(stderr, "*** Error: Unable to create texture from \"%s\": %s\n", PATH, SDL_GetError());
-                goto err_create_texture;
+
+        struct playback forward;
+        if(initPlayback(&forward, &recorded)){
+                fprintf(stderr, "*** Error: Unable to set up replay playback\n");
+                goto err_initPlayback;
         }
+        seekPlayback(&forward, options->seek);
 
-        SDL_FreeSurface(surface);
+        struct canvas canvas;
+        if(loadCanvas(&canvas, options->bundle)){
+                fprintf(stderr, "*** Error: Unable to set up framebuffer\n");
+                goto err_loadCanvas;
+        }
+
+        struct video video;
+        if(openVideo(&video, options->export, options->export_format, TICK_RATE)){
+                fprintf(stderr, "*** Error: Unable to open video\n");
+                goto err_openVideo;
+        }
 
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 START = SDL_GetPerformanceCounter();
+        Uint64 painting = 0;
+        while(1){
+                const Uint64 PAINT_START = SDL_GetPerformanceCounter();
+                paintWorld(&canvas, &forward.world);
+                painting += SDL_GetPerformanceCounter() - PAINT_START;
+
+                if(writeFrame(&video, canvas.pixels)){
+                        goto err_writeFrame;
+                }
+                if(forward.tick >= recorded.header.ticks){
+                        break;
+                }
+                stepPlayback(&forward);
+        }
+        if(closeVideo(&video)){
+                goto err_closeVideo;
+        }
+        const Uint64 END = SDL_GetPerformanceCounter();
+
+        const double SECONDS = (double)(END - START)/FREQUENCY;
+        fprintf(report, "Frames: %lu (%s, %dx%d at %d fps)\n", video.frames, VIDEO_FORMAT_NAMES[video.format], WIDTH, HEIGHT, TICK_RATE);
+        fprintf(report, "Blend kernel: %s\n", CANVAS_KERNEL_NAMES[canvas.kernel]);
+        fprintf(report, "Elapsed time: %.6f s\n", SECONDS);
+        fprintf(report, "Frames per second: %.0f\n", video.frames/SECONDS);
+        fprintf(report, "Drawing per frame: %.3f ms\n", 1000.0*painting/FREQUENCY/video.frames);
+        fprintf(report, "Speed: %.1fx real time\n", (double)video.frames/TICK_RATE/SECONDS);
+        if(hashWorld(&forward.world) != recorded.header.hash){
+                fprintf(stderr, "*** Error: Playback diverged from the recording\n");
+                goto err_diverged;
+        }
+
+        freeCanvas(&canvas);
+        freePlayback(&forward);
+        freeReplay(&recorded);
         return 0;
 
-err_create_texture:
-        SDL_FreeSurface(surface);
+err_writeFrame:
+        closeVideo(&video);
+err_closeVideo:
+err_diverged:
+err_openVideo:
+        freeCanvas(&canvas);
+err_loadCanvas:
+        freePlayback(&forward);
+err_initPlayback:
+        freeReplay(&recorded);
         return 1;
 }
 
-static void moveCharacter(struct character *character){
-        const int X_START = character->sprite.dimensions.x;
-        const int X_END = X_START + (character->sprite.dimensions.w - 1);
-        const int X_VEL = character->x_vel;
-        const int Y_START = character->sprite.dimensions.y;
-        const int Y_END = Y_START + (character->sprite.dimensions.h - 1);
-        const int Y_VEL = character->y_vel;
+static unsigned runHeadless(const unsigned long TICKS){
+        if(!TICKS){
+                fprintf(stderr, "*** Error: Number of ticks not specified\n");
+                return 1;
+        }
 
-        character->sprite.dimensions.x = (X_END + X_VEL > WIDTH - 1) ? WIDTH - character->sprite.dimensions.w : ((X_START + X_VEL < 0) ? 0 : X_START + X_VEL);
-        character->sprite.dimensions.y = (Y_END + Y_VEL > HEIGHT - 1) ? HEIGHT - character->sprite.dimensions.h : ((Y_START + Y_VEL < 0) ? 0 : Y_START + Y_VEL);
+        placePaddles(&world);
+        resetBall(&world);
+
+        unsigned long hits = 0;
+        unsigned long breaks = 0;
+        const Uint64 START = SDL_GetPerformanceCounter();
+        for(unsigned long i = 0; i < TICKS; i++){
+                trackBall(&world.player1, &world.ball);
+                if(bot_level){
+                        driveBot(&bot, &world.player2, &world.ball);
+                }else{
+                        trackBall(&world.player2, &world.ball);
+                }
+                const unsigned EVENTS = stepWorld(&world);
+                hits += (EVENTS & WORLD_HIT_BRICK) != 0;
+                breaks += (EVENTS & WORLD_BREAK_BRICK) != 0;
+        }
+        const Uint64 END = SDL_GetPerformanceCounter();
+
+        const double SECONDS = (double)(END - START)/SDL_GetPerformanceFrequency();
+        printf("Ticks: %lu\n", TICKS);
+        printf("Elapsed time: %.6f s\n", SECONDS);
+        printf("Ticks per second: %.0f\n", TICKS/SECONDS);
+        printf("Final score: %u - %u\n", world.player1.score, world.player2.score);
+        if(world.field){
+                printf("Bricks hit: %lu, broken: %lu of %u\n", hits, breaks, world.field->count);
+        }
+
+        return 0;
 }
 
-static unsigned newGame(SDL_Renderer *const renderer){
-        player1.score = 0;
-        if(updateScoreTexture(&player1, renderer)){
-                fprintf(stderr, "*** Error: Unable to update player 1 score texture\n");
+/* Results are folded in match order once every thread is done, so the
+ * totals and checksum do not depend on the number of threads */
+static unsigned runMatches(const unsigned MATCHES, const unsigned THREADS, const uint64_t SEED, const unsigned BOT_LEVEL){
+        struct match_result *const results = malloc(sizeof(*results)*MATCHES);
+        if(!results){
+                fprintf(stderr, "*** Error: Unable to allocate results for %u matches\n", MATCHES);
                 return 1;
         }
-        player2.score = 0;
-        if(updateScoreTexture(&player2, renderer)){
-                fprintf(stderr, "*** Error: Unable to update player 2 score texture\n");
+
+        const Uint64 START = SDL_GetPerformanceCounter();
+        if(playMatches(MATCHES, THREADS, SEED, MATCH_POINTS, BOT_LEVEL, results)){
+                fprintf(stderr, "*** Error: Unable to play matches\n");
+                goto err_playMatches;
+        }
+        const Uint64 END = SDL_GetPerformanceCounter();
+
+        unsigned long wins1 = 0;
+        unsigned long wins2 = 0;
+        unsigned long long ticks = 0;
+        unsigned long long hits = 0;
+        unsigned long long rallies = 0;
+        unsigned longest_rally = 0;
+        uint64_t checksum = 0xCBF29CE484222325u;
+        for(unsigned i = 0; i < MATCHES; i++){
+                const struct match_result *const RESULT = &results[i];
+                wins1 += RESULT->score1 > RESULT->score2;
+                wins2 += RESULT->score2 > RESULT->score1;
+                ticks += RESULT->ticks;
+                hits += RESULT->hits;
+                rallies += RESULT->rallies;
+                if(RESULT->longest_rally > longest_rally){
+                        longest_rally = RESULT->longest_rally;
+                }
+
+                const uint64_t FIELDS[] = { RESULT->score1, RESULT->score2, RESULT->ticks, RESULT->hits, RESULT->rallies, RESULT->longest_rally };
+                for(unsigned j = 0; j < sizeof(FIELDS)/sizeof(*FIELDS); j++){
+                        checksum = (checksum ^ FIELDS[j])*0x100000001B3u;
+                }
+        }
+
+        const double SECONDS = (double)(END - START)/SDL_GetPerformanceFrequency();
+        printf("Matches: %u\n", MATCHES);
+        printf("Threads: %u\n", THREADS);
+        printf("Seed: %llu\n", (unsigned long long)SEED);
+        printf("Elapsed time: %.6f s\n", SECONDS);
+        printf("Matches per second: %.0f\n", MATCHES/SECONDS);
+        printf("Ticks per second: %.0f\n", ticks/SECONDS);
+        printf("Wins: %lu - %lu\n", wins1, wins2);
+        printf("Mean rally length: %.3f hits\n", rallies ? (double)hits/rallies : 0.0);
+        printf("Longest rally: %u hits\n", longest_rally);
+        printf("Result checksum: %016llx\n", (unsigned long long)checksum);
+
+        free(results);
+        return 0;
+
+err_playMatches:
+        free(results);
+        return 1;
+}
+
+/* Both paddles follow the ball, each driven by its own instance, at the
+ * normal tick rate. Once both sides hold every input up to TICKS, each
+ * prints the final state hash, which must agree between the two. */
+static unsigned runNetHeadless(const struct options *const options){
+        if(!options->ticks){
+                fprintf(stderr, "*** Error: Number of ticks not specified\n");
+                return 1;
+        }
+
+        initWorld(&world, options->seed);
+        if(connectPeer(options)){
+                fprintf(stderr, "*** Error: Unable to connect to peer\n");
                 return 1;
         }
 
-        player1.avatar.sprite.dimensions.x = (2*player1.avatar.sprite.dimensions.w > WIDTH) ? 0 : player1.avatar.sprite.dimensions.w;
-        player1.avatar.sprite.dimensions.y = (HEIGHT - player1.avatar.sprite.dimensions.h)/2;
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 TICK_PERIOD = FREQUENCY/TICK_RATE;
+        struct player *const local = rollback.player ? &world.player2 : &world.player1;
+        Uint64 nextTick = SDL_GetPerformanceCounter();
+        Uint64 confirmed_at = 0;
+        for(;;){
+                if(pollNet()){
+                        fprintf(stderr, "*** Error: Unable to communicate with peer\n");
+                        goto err_pollNet;
+                }
+
+                const Uint64 NOW = SDL_GetPerformanceCounter();
+                if(NOW - last_heard > FREQUENCY*PEER_TIMEOUT/1000){
+                        fprintf(stderr, "*** Error: Lost contact with peer\n");
+                        goto err_timeout;
+                }
+
+                if(rollback.tick < options->ticks){
+                        if(rollbackStalled(&rollback)){
+                                stalled_frames++;
+                                if(sendInputs()){
+                                        goto err_sendInputs;
+                                }
+                        }else{
+                                trackBall(local, &world.ball);
+                                if(tickWorld()){
+                                        goto err_tickWorld;
+                                }
+                        }
+                }else if(rollback.confirmed >= options->ticks){
+                        /* Linger so that a lost final ack is not fatal to the peer */
+                        if(!confirmed_at){
+                                confirmed_at = NOW;
+                        }
+                        if(rollback.acked >= options->ticks || NOW - confirmed_at > FREQUENCY){
+                                break;
+                        }
+                        if(sendInputs()){
+                                goto err_sendInputs;
+                        }
+                }else if(sendInputs()){
+                        goto err_sendInputs;
+                }
 
-        player2.avatar.sprite.dimensions.x = (WIDTH < 2*player2.avatar.sprite.dimensions.w) ? 0 : WIDTH - 2*player2.avatar.sprite.dimensions.w;
-        player2.avatar.sprite.dimensions.y = (HEIGHT - player2.avatar.sprite.dimensions.h)/2;
+                nextTick += TICK_PERIOD;
+                sleepUntil(nextTick, FREQUENCY);
+        }
 
-        ball.x_vel = 5;
-        resetBall();
+        settleRollback(&rollback);
+        world = rollback.world;
 
+        printf("Player: %u\n", options->player);
+        printf("Ticks: %lu\n", options->ticks);
+        printf("Final score: %u - %u\n", world.player1.score, world.player2.score);
+        printf("Final state hash: %016llx\n", (unsigned long long)hashWorld(&world));
+        printNetStats(options->ticks);
+
+        closeNet(&net);
         return 0;
-}
 
-static void paddleBounce(void){
-        ball.y_vel = rand() % 6;
-        ball.y_vel *= (rand() % 2) ? -1 : 1;
+err_sendInputs:
+err_tickWorld:
+err_timeout:
+err_pollNet:
+        closeNet(&net);
+        return 1;
 }
 
-static unsigned processWorld(SDL_Renderer *const renderer){
-        moveCharacter(&player1.avatar);
-        moveCharacter(&player2.avatar);
-        moveCharacter(&ball);
+/* Plays the whole replay back as fast as possible, checks that it ends
+ * in the recorded state, and then seeks back to SEEK via the snapshots */
+static unsigned runReplay(const char *const PATH, const unsigned long SEEK){
+        struct replay recorded;
+        if(loadReplay(PATH, &recorded)){
+                fprintf(stderr, "*** Error: Unable to load replay\n");
+                return 1;
+        }
 
-        const int BALL_X_START = ball.sprite.dimensions.x;
-        const int BALL_X_END = BALL_X_START + (ball.sprite.dimensions.w-1);
-        const int BALL_Y_START = ball.sprite.dimensions.y;
-        const int BALL_Y_END = BALL_Y_START + (ball.sprite.dimensions.h-1);
+        struct playback forward;
+        if(initPlayback(&forward, &recorded)){
+                fprintf(stderr, "*** Error: Unable to set up replay playback\n");
+                goto err_initPlayback;
+        }
 
-        const int PLAYER1_X_START = player1.avatar.sprite.dimensions.x;
-        const int PLAYER1_X_END = PLAYER1_X_START + (player1.avatar.sprite.dimensions.w-1);
-        const int PLAYER1_Y_START = player1.avatar.sprite.dimensions.y;
-        const int PLAYER1_Y_END = PLAYER1_Y_START + (player1.avatar.sprite.dimensions.h-1);
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 START = SDL_GetPerformanceCounter();
+        seekPlayback(&forward, recorded.header.ticks);
+        const Uint64 END = SDL_GetPerformanceCounter();
+
+        const double SECONDS = (double)(END - START)/FREQUENCY;
+        printf("Ticks: %llu\n", (unsigned long long)recorded.header.ticks);
+        printf("Event bytes: %u\n", recorded.header.size);
+        printf("Elapsed time: %.6f s\n", SECONDS);
+        printf("Ticks per second: %.0f\n", recorded.header.ticks/SECONDS);
+        printf("Final score: %u - %u\n", forward.world.player1.score, forward.world.player2.score);
+        if(hashWorld(&forward.world) != recorded.header.hash){
+                fprintf(stderr, "*** Error: Playback diverged from the recording\n");
+                goto err_diverged;
+        }
+        printf("Final state matches the recording\n");
+
+        if(SEEK){
+                const Uint64 REWIND_START = SDL_GetPerformanceCounter();
+                seekPlayback(&forward, SEEK);
+                const Uint64 REWIND_END = SDL_GetPerformanceCounter();
+                printf("Seek to tick %llu: %.3f ms\n", (unsigned long long)forward.tick, 1000.0*(REWIND_END - REWIND_START)/FREQUENCY);
+                printf("Score at tick %llu: %u - %u\n", (unsigned long long)forward.tick, forward.world.player1.score, forward.world.player2.score);
+        }
 
-        const int PLAYER2_X_START = player2.avatar.sprite.dimensions.x;
-        const int PLAYER2_X_END = PLAYER2_X_START + (player2.avatar.sprite.dimensions.w-1);
-        const int PLAYER2_Y_START = player2.avatar.sprite.dimensions.y;
-        const int PLAYER2_Y_END = PLAYER2_Y_START + (player2.avatar.sprite.dimensions.h-1);
+        freePlayback(&forward);
+        freeReplay(&recorded);
+        return 0;
 
-        if(BALL_X_START == 0){
-                player2.score++;
-                if(updateScoreTexture(&player2, renderer)){
-                        fprintf(stderr, "*** Error: Unable to update player 1 score texture\n");
-                        return 1;
+err_diverged:
+        freePlayback(&forward);
+err_initPlayback:
+        freeReplay(&recorded);
+        return 1;
+}
+
+static unsigned sendInputs(void){
+        unsigned char packet[ROLLBACK_PACKET_SIZE];
+
+        if(sendNet(&net, packet, writeInputs(&rollback, packet)) || flushNet(&net)){
+                fprintf(stderr, "*** Error: Unable to send inputs to peer\n");
+                return 1;
+        }
+
+        return 0;
+}
+
+/* Runs the game at TICK_RATE on its own thread, so that ticks stay
+ * evenly spaced however long frames take to draw and present. Each tick
+ * is due at the end of the span of time it simulates and sees the
+ * inputs that happened up to then; a tick that comes late is run at
+ * once, but never more than MAX_CATCHUP_TICKS of them in a row. */
+static void *simulate(void *const argument){
+        (void)argument;
+
+        const Uint64 FREQUENCY = SDL_GetPerformanceFrequency();
+        const Uint64 TICK_PERIOD = FREQUENCY/TICK_RATE;
+        Uint64 nextTick = SDL_GetPerformanceCounter() + TICK_PERIOD;
+        Uint64 lastTick = 0;
+        while(!__atomic_load_n(&sim_quit, __ATOMIC_ACQUIRE)){
+                if(__atomic_load_n(&sim_paused, __ATOMIC_ACQUIRE)){
+                        SDL_Delay(PAUSE_POLL);
+                        nextTick = SDL_GetPerformanceCounter() + TICK_PERIOD;
+                        lastTick = 0;
+                        continue;
                 }
-                resetBall();
-        }else if(BALL_X_END == WIDTH - 1){
-                player1.score++;
-                if(updateScoreTexture(&player1, renderer)){
-                        fprintf(stderr, "*** Error: Unable to update player 2 score texture\n");
-                        return 1;
+
+                sleepUntil(nextTick, FREQUENCY);
+                if(networked && pollNet()){
+                        fprintf(stderr, "*** Error: Unable to communicate with peer\n");
+                        goto err_pollNet;
                 }
-                resetBall();
-        }else if((BALL_X_START >= PLAYER1_X_START && BALL_X_START <= PLAYER1_X_END) || (BALL_X_END >= PLAYER1_X_START && BALL_X_END <= PLAYER1_X_END)){
-                if((BALL_Y_START >= PLAYER1_Y_START && BALL_Y_START <= PLAYER1_Y_END) || (BALL_Y_END >= PLAYER1_Y_START && BALL_Y_END <= PLAYER1_Y_END)){
-                        ball.sprite.dimensions.x = PLAYER1_X_END + 1;
-                        ball.x_vel *= -1;
-                        paddleBounce();
+
+                const Uint64 NOW = SDL_GetPerformanceCounter();
+                if(NOW - nextTick >= MAX_CATCHUP_TICKS*TICK_PERIOD){
+                        nextTick = NOW - (MAX_CATCHUP_TICKS - 1)*TICK_PERIOD;
                 }
-        }else if((BALL_X_START >= PLAYER2_X_START && BALL_X_START <= PLAYER2_X_END) || (BALL_X_END >= PLAYER2_X_START && BALL_X_END <= PLAYER2_X_END)){
-                if((BALL_Y_START >= PLAYER2_Y_START && BALL_Y_START <= PLAYER2_Y_END) || (BALL_Y_END >= PLAYER2_Y_START && BALL_Y_END <= PLAYER2_Y_END)){
-                        ball.sprite.dimensions.x = PLAYER2_X_START - ball.sprite.dimensions.w;
-                        ball.x_vel *= -1;
-                        paddleBounce();
+                while(nextTick <= NOW){
+                        if(networked && rollbackStalled(&rollback)){
+                                stalled_frames++;
+                                if(sendInputs() || waitNet(&net, STALL_WAIT)){
+                                        goto err_tickWorld;
+                                }
+                                break;
+                        }
+
+                        const Uint64 TICK_START = SDL_GetPerformanceCounter();
+                        if(lastTick){
+                                recordSample(&tick_interval, TICK_START - lastTick, FREQUENCY);
+                        }
+                        lastTick = TICK_START;
+
+                        struct snapshot *const snapshot = &snapshots.slots[snapshots.back];
+                        snapshot->previous[0] = world.ball.box;
+                        snapshot->previous[1] = world.player1.avatar.box;
+                        snapshot->previous[2] = world.player2.avatar.box;
+                        const unsigned JUMPED = applyInputs(nextTick);
+                        const unsigned SCORE1 = world.player1.score;
+                        const unsigned SCORE2 = world.player2.score;
+                        if(tickWorld()){
+                                goto err_tickWorld;
+                        }
+                        snapshot->continuous = !JUMPED && SCORE1 == world.player1.score && SCORE2 == world.player2.score;
+                        fillSnapshot(snapshot, nextTick);
+                        publishSnapshot(&snapshots);
+
+                        nextTick += TICK_PERIOD;
                 }
-        }else if(BALL_Y_START == 0 || BALL_Y_END == HEIGHT -1){
-                ball.y_vel *= -1;
         }
 
-        return 0;
+        return NULL;
+
+err_tickWorld:
+err_pollNet:
+        __atomic_store_n(&sim_failed, 1, __ATOMIC_RELEASE);
+        return NULL;
 }
 
-static void resetBall(void){
-        ball.sprite.dimensions.x = (WIDTH - ball.sprite.dimensions.w)/2;
-        ball.sprite.dimensions.y = rand() % (HEIGHT - ball.sprite.dimensions.h);
+/* The whole wait is slept through on the monotonic clock, waking up to
+ * a millisecond late rather than spinning a core on both the render and
+ * simulation threads */
+static void sleepUntil(const Uint64 DEADLINE, const Uint64 FREQUENCY){
+        const Uint64 NOW = SDL_GetPerformanceCounter();
+        if(NOW >= DEADLINE){
+                return;
+        }
+
+        const Uint64 WAIT = DEADLINE - NOW;
+        struct timespec wake;
+        clock_gettime(CLOCK_MONOTONIC, &wake);
+        wake.tv_sec += WAIT/FREQUENCY;
+        wake.tv_nsec += WAIT%FREQUENCY*1000000000/FREQUENCY;
+        if(wake.tv_nsec >= 1000000000){
+                wake.tv_sec++;
+                wake.tv_nsec -= 1000000000;
+        }
 
-        paddleBounce();
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR);
 }
 
-static unsigned updateScoreTexture(struct player *const player, SDL_Renderer *const renderer){
-        char score_str[16];
-        snprintf(score_str, sizeof(score_str), "%u", player->score);
+/* Every snapshot starts out as the world as it stands, so that frames
+ * may be drawn before the first tick is published */
+static unsigned startSimulation(void){
+        const Uint64 NOW = SDL_GetPerformanceCounter();
+        for(unsigned i = 0; i < SNAPSHOT_SLOTS; i++){
+                snapshots.slots[i].continuous = 0;
+                fillSnapshot(&snapshots.slots[i], NOW);
+        }
 
-        const SDL_Color COLOR = { .r = 255, .g = 255, .b = 255 };
-        SDL_Surface *font_surface = TTF_RenderText_Solid(font, score_str, COLOR);
-        if(!font_surface){
-                fprintf(stderr, "*** Error: Unable to render score text: %s\n", TTF_GetError());
+        if(pthread_create(&simulation, NULL, simulate, NULL)){
+                fprintf(stderr, "*** Error: Unable to start simulation thread\n");
                 return 1;
         }
 
-        player->score_display.dimensions.w = (font_surface->w > WIDTH) ? WIDTH : font_surface->w;
-        player->score_display.dimensions.h = (font_surface->h > HEIGHT) ? HEIGHT : font_surface->h;
-        player->score_display.texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-        if(!player->score_display.texture){
-                fprintf(stderr, "*** Error: Unable to create texture from score text surface: %s\n", SDL_GetError());
-                goto err_create_texture;
+        return 0;
+}
+
+static void stopSimulation(void){
+        __atomic_store_n(&sim_quit, 1, __ATOMIC_RELEASE);
+        pthread_join(simulation, NULL);
+}
+
+static unsigned tickWorld(void){
+        if(networked){
+                const struct player *const LOCAL = rollback.player ? &world.player2 : &world.player1;
+                const unsigned long RESIMULATED = rollback.resimulated;
+                const Uint64 START = SDL_GetPerformanceCounter();
+                advanceRollback(&rollback, LOCAL->avatar.y_vel);
+                if(rollback.resimulated != RESIMULATED){
+                        recordSample(&resimulation, SDL_GetPerformanceCounter() - START, SDL_GetPerformanceFrequency());
+                }
+                world = rollback.world;
+                return sendInputs();
         }
 
-        SDL_FreeSurface(font_surface);
+        if(replaying){
+                if(playback.tick < replay.header.ticks){
+                        stepPlayback(&playback);
+                        world = playback.world;
+                }
+                return 0;
+        }
 
-        return 0;
+        if(bot_level){
+                driveBot(&bot, &world.player2, &world.ball);
+        }
 
-err_create_texture:
-        SDL_FreeSurface(font_surface);
-        return 1;
+        if(recording && recordTick(&replay, &world)){
+                fprintf(stderr, "*** Error: Unable to record tick\n");
+                return 1;
+        }
+
+        if(!arena.count){
+                stepWorld(&world);
+                return 0;
+        }
+
+        moveCharacter(&world.player1.avatar);
+        moveCharacter(&world.player2.avatar);
+        return stepArena(&arena, &world, arena_kernel);
+}
+
+/* Profiling stays on while the overlay is shown, even without --profile */
+static void toggleHud(void){
+        hud = !hud;
+        profile.enabled = hud || profiling;
+        scene.profile = hud ? &profile : NULL;
+        startFrame(&profile);
 }
@@ -0,0 +1,94 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#include "histogram.h"
+
+static unsigned bucketIndex(const uint64_t VALUE);
+static uint64_t bucketValue(const unsigned INDEX);
+
+/* Reports the upper edge of the bucket holding the given percentile */
+uint64_t histogramPercentile(const struct histogram *const histogram, const double PERCENTILE){
+        if(!histogram->count){
+                return 0;
+        }
+
+        const uint64_t RANK = (uint64_t)(PERCENTILE/100*(histogram->count - 1)) + 1;
+        uint64_t seen = 0;
+        for(unsigned i = 0; i < HISTOGRAM_BUCKETS; i++){
+                seen += histogram->buckets[i];
+                if(seen >= RANK){
+                        const uint64_t VALUE = bucketValue(i);
+                        return (VALUE < histogram->max) ? VALUE : histogram->max;
+                }
+        }
+
+        return histogram->max;
+}
+
+/* Adds the samples of OTHER, such as another thread's, to HISTOGRAM */
+void mergeHistogram(struct histogram *const histogram, const struct histogram *const OTHER){
+        for(unsigned i = 0; i < HISTOGRAM_BUCKETS; i++){
+                histogram->buckets[i] += OTHER->buckets[i];
+        }
+        histogram->count += OTHER->count;
+        if(OTHER->max > histogram->max){
+                histogram->max = OTHER->max;
+        }
+}
+
+void recordHistogram(struct histogram *const histogram, const uint64_t VALUE){
+        histogram->buckets[bucketIndex(VALUE)]++;
+        histogram->count++;
+        if(VALUE > histogram->max){
+                histogram->max = VALUE;
+        }
+}
+
+static unsigned bucketIndex(const uint64_t VALUE){
+        if(VALUE < (1u << HISTOGRAM_SUB_BITS)){
+                return VALUE;
+        }
+
+        const unsigned EXPONENT = 63 - __builtin_clzll(VALUE);
+        const unsigned SHIFT = EXPONENT - HISTOGRAM_SUB_BITS;
+        const unsigned MANTISSA = (VALUE >> SHIFT) & ((1u << HISTOGRAM_SUB_BITS) - 1);
+
+        return ((SHIFT + 1) << HISTOGRAM_SUB_BITS) + MANTISSA;
+}
+
+static uint64_t bucketValue(const unsigned INDEX){
+        if(INDEX < (1u << HISTOGRAM_SUB_BITS)){
+                return INDEX;
+        }
+
+        const unsigned SHIFT = (INDEX >> HISTOGRAM_SUB_BITS) - 1;
+        const uint64_t MANTISSA = INDEX & ((1u << HISTOGRAM_SUB_BITS) - 1);
+
+        return (((1u << HISTOGRAM_SUB_BITS) + MANTISSA + 1) << SHIFT) - 1;
+}
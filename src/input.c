@@ -0,0 +1,58 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "input.h"
+
+/* The oldest input, should it have happened no later than DEADLINE */
+const struct input_event *peekInput(struct input_queue *const queue, const uint64_t DEADLINE){
+        const unsigned TAIL = queue->tail;
+        if(__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == TAIL){
+                return NULL;
+        }
+
+        const struct input_event *const EVENT = &queue->events[TAIL % INPUT_QUEUE_SIZE];
+        return (EVENT->time <= DEADLINE) ? EVENT : NULL;
+}
+
+void popInput(struct input_queue *const queue){
+        __atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+}
+
+unsigned pushInput(struct input_queue *const queue, const struct input_event *const EVENT){
+        const unsigned HEAD = queue->head;
+        if(HEAD - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == INPUT_QUEUE_SIZE){
+                return 1;
+        }
+
+        queue->events[HEAD % INPUT_QUEUE_SIZE] = *EVENT;
+        __atomic_store_n(&queue->head, HEAD + 1, __ATOMIC_RELEASE);
+
+        return 0;
+}
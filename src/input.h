@@ -0,0 +1,66 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+/* Must be a power of two */
+#define INPUT_QUEUE_SIZE 256
+
+enum input_type{
+        INPUT_PADDLE,
+        INPUT_RESET,
+        INPUT_SEEK
+};
+
+/* Something the player did, stamped with the time the key event was
+ * generated, in performance counter units. VALUE is the new paddle
+ * y_vel, or the number of ticks to seek by. */
+struct input_event{
+        uint64_t time;
+        enum input_type type;
+        unsigned player;
+        int value;
+};
+
+/* Inputs pass from the event loop to the simulation thread through this
+ * single-producer, single-consumer ring, and wait in it until the tick
+ * in which they happened. HEAD and TAIL count pushes and pops without
+ * wrapping, and each is written by one thread only. */
+struct input_queue{
+        struct input_event events[INPUT_QUEUE_SIZE];
+        unsigned head __attribute__((aligned(64)));
+        unsigned tail __attribute__((aligned(64)));
+};
+
+const struct input_event *peekInput(struct input_queue *const queue, const uint64_t DEADLINE);
+void popInput(struct input_queue *const queue);
+unsigned pushInput(struct input_queue *const queue, const struct input_event *const EVENT);
+
+#endif
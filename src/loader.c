@@ -0,0 +1,106 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "SDL.h"
+
+#include "atlas.h"
+#include "bundle.h"
+#include "loader.h"
+
+static void *loadAtlas(void *const argument);
+
+/* Returns nonzero if the atlas could not be loaded */
+unsigned finishLoader(struct loader *const loader){
+        pthread_join(loader->thread, NULL);
+
+        return loader->failed;
+}
+
+void freeLoader(struct loader *const loader){
+        if(loader->bundled){
+                closeBundle(&loader->bundle);
+                loader->bundled = 0;
+        }
+        SDL_FreeSurface(loader->surface);
+        loader->surface = NULL;
+}
+
+unsigned loaderDone(const struct loader *const LOADER){
+        return __atomic_load_n(&LOADER->done, __ATOMIC_ACQUIRE);
+}
+
+unsigned startLoader(struct loader *const loader, const char *const BUNDLE, const char *const MEDIA_DIR){
+        *loader = (struct loader){ .bundle_path = BUNDLE, .media_dir = MEDIA_DIR };
+
+        if(pthread_create(&loader->thread, NULL, loadAtlas, loader)){
+                fprintf(stderr, "*** Error: Unable to start loader thread\n");
+                return 1;
+        }
+
+        return 0;
+}
+
+/* The prebuilt bundle is preferred, as it needs neither PNG decoding nor
+ * font rasterization; the media files are only read without one */
+static void *loadAtlas(void *const argument){
+        struct loader *const loader = argument;
+
+        if(!openBundle(loader->bundle_path, &loader->bundle)){
+                loader->bundled = 1;
+
+                /* Reading a byte of every page now spares the render
+                 * thread the disk reads when it uploads the pixels */
+                const long PAGE = sysconf(_SC_PAGESIZE);
+                const unsigned char *const BYTES = (const unsigned char *)loader->bundle.header;
+                volatile unsigned char sink = 0;
+                for(size_t i = 0; i < loader->bundle.size; i += (PAGE > 0) ? PAGE : 4096){
+                        sink ^= BYTES[i];
+                }
+        }else{
+                SDL_Surface *surfaces[ATLAS_ENTRIES] = { NULL };
+                if(loadAtlasSurfaces(loader->media_dir, surfaces)){
+                        fprintf(stderr, "*** Error: Unable to load sprites\n");
+                        loader->failed = 1;
+                }else{
+                        loader->surface = packAtlas(surfaces, &loader->atlas);
+                        if(!loader->surface){
+                                fprintf(stderr, "*** Error: Unable to pack sprite atlas\n");
+                                loader->failed = 1;
+                        }
+                }
+                for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                        SDL_FreeSurface(surfaces[i]);
+                }
+        }
+
+        __atomic_store_n(&loader->done, 1, __ATOMIC_RELEASE);
+        return NULL;
+}
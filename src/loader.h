@@ -0,0 +1,61 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <pthread.h>
+
+#include "SDL.h"
+
+#include "atlas.h"
+#include "bundle.h"
+
+/* Reads the sprite atlas on a thread of its own while the render thread
+ * shows a first frame: the bundle when there is one, its pages faulted
+ * in from disk, and otherwise the media files, decoded in parallel and
+ * packed into SURFACE with ATLAS giving where each sprite went. Only
+ * the texture upload, which needs the renderer, is left to the render
+ * thread once loaderDone() says the atlas is ready. */
+struct loader{
+        pthread_t thread;
+        const char *bundle_path;
+        const char *media_dir;
+        struct bundle bundle;
+        unsigned bundled;
+        SDL_Surface *surface;
+        struct atlas atlas;
+        unsigned done;
+        unsigned failed;
+};
+
+unsigned finishLoader(struct loader *const loader);
+void freeLoader(struct loader *const loader);
+unsigned loaderDone(const struct loader *const LOADER);
+unsigned startLoader(struct loader *const loader, const char *const BUNDLE, const char *const MEDIA_DIR);
+
+#endif
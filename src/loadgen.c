@@ -0,0 +1,497 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "histogram.h"
+#include "protocol.h"
+#include "world.h"
+
+#define TICK_RATE 30
+#define TICK_PERIOD (1000000000u/TICK_RATE)
+#define LOAD_SERVER "localhost:7777"
+#define LOAD_SOCKET_BUFFER (4 << 20)
+
+/* Seconds each stage runs before it is measured, for its new matches
+ * to be joined */
+#define LOAD_WARMUP 1
+
+/* Inputs whose send times are kept, to time the states echoing them */
+#define LOAD_INPUTS 64
+
+/* A stage is sustained when matches advance at no less than
+ * LOAD_MIN_RATE percent of the tick rate and 99% of inputs are echoed
+ * within LOAD_MAX_P99 tick periods */
+#define LOAD_MIN_RATE 98
+#define LOAD_MAX_P99 2
+
+/* One side of a simulated match. PORT is that of the worker the player
+ * was last told hosts the match, and STATES the last PROTOCOL_HISTORY
+ * states received, as bases for deltas. */
+struct side{
+        unsigned accepted;
+        unsigned port;
+        uint32_t sequence;
+        uint32_t echoed;
+        uint32_t newest;
+        uint64_t sent[LOAD_INPUTS];
+        struct protocol_state states[PROTOCOL_HISTORY];
+};
+
+struct game{
+        uint32_t key;
+        struct side players[2];
+};
+
+struct stage{
+        uint64_t ticks;
+        uint64_t lost;
+        unsigned playing;
+        unsigned workers;
+        struct histogram latency;
+};
+
+/* Each thread plays every match whose index it is given modulo the
+ * number of threads, over a socket of its own. Its stage so far is
+ * handed to the main thread as REPORT whenever the epoch changes, with
+ * REPORTED set to the new epoch once it is. */
+struct thread{
+        pthread_t thread;
+        struct load *load;
+        unsigned id;
+        int fd;
+        struct game *games;
+        unsigned game_count;
+        struct stage current;
+        struct stage report;
+        uint32_t reported;
+} __attribute__((aligned(64)));
+
+struct load{
+        struct thread *threads;
+        unsigned count;
+        unsigned max;
+        struct sockaddr_storage server;
+        socklen_t length;
+        unsigned port;
+        unsigned target;
+        uint32_t epoch;
+        unsigned stop;
+};
+
+struct options{
+        const char *server;
+        unsigned threads;
+        unsigned start;
+        unsigned step;
+        unsigned max;
+        unsigned stage;
+};
+
+static void collectStage(struct load *const load, struct stage *const stage);
+static void handlePacket(struct thread *const thread, const unsigned char *const DATA, const size_t SIZE, const uint64_t NOW);
+static uint64_t nanoseconds(void);
+static unsigned openThread(struct thread *const thread, struct load *const load, const unsigned ID);
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options);
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number);
+static unsigned resolveServer(struct load *const load, const char *const SERVER);
+static void *runThread(void *const argument);
+static void sendPacket(const struct thread *const THREAD, const unsigned PORT, const unsigned char *const DATA, const size_t SIZE);
+static void sleepSeconds(const unsigned SECONDS);
+static void tickGames(struct thread *const thread, const uint64_t NOW);
+
+/* Plays ever more matches against a server, a stage at a time, until
+ * one is no longer sustained, then reports the most that were */
+int main(int argc, char *argv[]){
+        struct options options = { .server = LOAD_SERVER, .threads = 2, .start = 100, .step = 100, .max = 10000, .stage = 5 };
+        if(parseArgs(argc, argv, &options)){
+                fprintf(stderr, "Usage: %s [--server HOST:PORT] [--threads N] [--start N] [--step N] [--max N] [--stage SECONDS]\n", argv[0]);
+                return 1;
+        }
+
+        struct load load = { .count = options.threads, .max = options.max };
+        if(resolveServer(&load, options.server)){
+                return 1;
+        }
+        if(posix_memalign((void **)&load.threads, 64, sizeof(*load.threads)*load.count)){
+                fprintf(stderr, "*** Error: Unable to allocate %u threads\n", load.count);
+                return 1;
+        }
+
+        unsigned opened = 0;
+        while(opened < load.count){
+                if(openThread(&load.threads[opened], &load, opened)){
+                        goto err_openThread;
+                }
+                opened++;
+        }
+
+        unsigned started = 0;
+        while(started < load.count){
+                if(pthread_create(&load.threads[started].thread, NULL, runThread, &load.threads[started])){
+                        fprintf(stderr, "*** Error: Unable to start thread %u\n", started);
+                        goto err_pthread_create;
+                }
+                started++;
+        }
+
+        unsigned sustained = 0;
+        unsigned workers = 1;
+        printf("matches  per_core  p50_ms  p99_ms  ticks/s  lost\n");
+        for(unsigned matches = options.start; matches <= options.max; matches += options.step){
+                struct stage stage;
+                __atomic_store_n(&load.target, matches, __ATOMIC_RELEASE);
+                sleepSeconds(LOAD_WARMUP);
+                collectStage(&load, &stage);
+                workers = stage.workers ? stage.workers : workers;
+
+                const uint64_t START = nanoseconds();
+                sleepSeconds(options.stage);
+                collectStage(&load, &stage);
+                const double SECONDS = (nanoseconds() - START)/1e9;
+
+                workers = stage.workers ? stage.workers : workers;
+                const double RATE = stage.ticks/(matches*SECONDS);
+                const uint64_t P99 = histogramPercentile(&stage.latency, 99);
+                printf("%7u  %8.1f  %6.2f  %6.2f  %7.2f  %4llu\n", matches, (double)matches/workers, histogramPercentile(&stage.latency, 50)/1e6, P99/1e6, RATE, (unsigned long long)stage.lost);
+                fflush(stdout);
+                if(stage.playing < matches || RATE*100 < LOAD_MIN_RATE*TICK_RATE || P99 > LOAD_MAX_P99*(uint64_t)TICK_PERIOD){
+                        break;
+                }
+                sustained = matches;
+        }
+        printf("Sustained %u matches on %u server workers, %.1f per core\n", sustained, workers, (double)sustained/workers);
+
+        __atomic_store_n(&load.stop, 1, __ATOMIC_RELEASE);
+        for(unsigned i = 0; i < started; i++){
+                pthread_join(load.threads[i].thread, NULL);
+        }
+        for(unsigned i = 0; i < opened; i++){
+                close(load.threads[i].fd);
+                free(load.threads[i].games);
+        }
+        free(load.threads);
+
+        return 0;
+
+err_pthread_create:
+        __atomic_store_n(&load.stop, 1, __ATOMIC_RELEASE);
+        for(unsigned i = 0; i < started; i++){
+                pthread_join(load.threads[i].thread, NULL);
+        }
+err_openThread:
+        for(unsigned i = 0; i < opened; i++){
+                close(load.threads[i].fd);
+                free(load.threads[i].games);
+        }
+        free(load.threads);
+        return 1;
+}
+
+/* Starts a new epoch and merges what every thread reports of the last */
+static void collectStage(struct load *const load, struct stage *const stage){
+        const uint32_t EPOCH = __atomic_add_fetch(&load->epoch, 1, __ATOMIC_ACQ_REL);
+
+        memset(stage, 0, sizeof(*stage));
+        for(unsigned i = 0; i < load->count; i++){
+                const struct thread *const THREAD = &load->threads[i];
+                while(__atomic_load_n(&THREAD->reported, __ATOMIC_ACQUIRE) != EPOCH){
+                        const struct timespec WAIT = { .tv_nsec = 1000000 };
+                        nanosleep(&WAIT, NULL);
+                }
+                stage->ticks += THREAD->report.ticks;
+                stage->lost += THREAD->report.lost;
+                stage->playing += THREAD->report.playing;
+                if(THREAD->report.workers){
+                        stage->workers = THREAD->report.workers;
+                }
+                mergeHistogram(&stage->latency, &THREAD->report.latency);
+        }
+}
+
+/* A state is timed by the input it is the first to echo, and a finished
+ * match is started again under a new key */
+static void handlePacket(struct thread *const thread, const unsigned char *const DATA, const size_t SIZE, const uint64_t NOW){
+        const struct load *const LOAD = thread->load;
+        struct protocol_message message;
+        if(readMessage(DATA, SIZE, &message) || !message.key){
+                return;
+        }
+        const unsigned INDEX = (message.key - 1) % LOAD->max;
+        if(INDEX % LOAD->count != thread->id){
+                return;
+        }
+        struct game *const game = &thread->games[INDEX/LOAD->count];
+        if(game->key != message.key){
+                return;
+        }
+        struct side *const player = &game->players[message.player - 1];
+
+        if(message.type == PROTOCOL_WELCOME){
+                thread->current.workers = message.workers;
+                player->accepted = message.flags & PROTOCOL_ACCEPTED;
+                player->port = message.port;
+                return;
+        }
+        if(message.type != PROTOCOL_STATE || !player->accepted){
+                return;
+        }
+
+        const struct protocol_state *const BASE = &player->states[message.base % PROTOCOL_HISTORY];
+        if(message.base && BASE->tick != message.base){
+                thread->current.lost++;
+                return;
+        }
+        if((int32_t)(message.state.tick - player->newest) > 0){
+                applyState(&message, message.base ? BASE : NULL, &player->states[message.state.tick % PROTOCOL_HISTORY]);
+                player->newest = message.state.tick;
+                if(message.player == 1){
+                        thread->current.ticks++;
+                }
+        }
+        if((int32_t)(message.sequence - player->echoed) > 0 && player->sequence - message.sequence < LOAD_INPUTS){
+                recordHistogram(&thread->current.latency, NOW - player->sent[message.sequence % LOAD_INPUTS]);
+                player->echoed = message.sequence;
+        }
+
+        if(message.flags & PROTOCOL_FINISHED){
+                memset(game->players, 0, sizeof(game->players));
+                game->key += LOAD->max;
+                game->players[0].port = game->players[1].port = LOAD->port;
+        }
+}
+
+static uint64_t nanoseconds(void){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t)now.tv_sec*1000000000u + now.tv_nsec;
+}
+
+static unsigned openThread(struct thread *const thread, struct load *const load, const unsigned ID){
+        memset(thread, 0, sizeof(*thread));
+        thread->load = load;
+        thread->id = ID;
+        thread->game_count = (load->max + load->count - 1 - ID)/load->count;
+        thread->games = calloc(thread->game_count ? thread->game_count : 1, sizeof(*thread->games));
+        if(!thread->games){
+                fprintf(stderr, "*** Error: Unable to allocate %u games\n", thread->game_count);
+                return 1;
+        }
+        for(unsigned i = 0; i < thread->game_count; i++){
+                thread->games[i].key = ID + i*load->count + 1;
+                thread->games[i].players[0].port = thread->games[i].players[1].port = load->port;
+        }
+
+        thread->fd = socket(load->server.ss_family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if(thread->fd < 0){
+                fprintf(stderr, "*** Error: Unable to create socket: %s\n", strerror(errno));
+                free(thread->games);
+                return 1;
+        }
+        const int BUFFER = LOAD_SOCKET_BUFFER;
+        if(setsockopt(thread->fd, SOL_SOCKET, SO_RCVBUF, &BUFFER, sizeof(BUFFER)) || setsockopt(thread->fd, SOL_SOCKET, SO_SNDBUF, &BUFFER, sizeof(BUFFER))){
+                fprintf(stderr, "*** Warning: Unable to enlarge socket buffers: %s\n", strerror(errno));
+        }
+
+        return 0;
+}
+
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options){
+        for(int i = 1; i < argc; i++){
+                unsigned long number;
+                if(!strcmp(argv[i], "--max") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1u << 24, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid maximum number of matches \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->max = number;
+                }else if(!strcmp(argv[i], "--server") && i + 1 < argc){
+                        options->server = argv[++i];
+                }else if(!strcmp(argv[i], "--stage") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 3600, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid stage length \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->stage = number;
+                }else if(!strcmp(argv[i], "--start") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1u << 24, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid starting number of matches \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->start = number;
+                }else if(!strcmp(argv[i], "--step") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1u << 24, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid step \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->step = number;
+                }else if(!strcmp(argv[i], "--threads") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1024, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of threads \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->threads = number;
+                }else{
+                        fprintf(stderr, "*** Error: Unknown option \"%s\"\n", argv[i]);
+                        return 1;
+                }
+        }
+
+        if(options->start > options->max){
+                fprintf(stderr, "*** Error: Starting number of matches is above the maximum\n");
+                return 1;
+        }
+
+        return 0;
+}
+
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number){
+        char *end;
+        errno = 0;
+        *number = strtoul(STRING, &end, 10);
+
+        return end == STRING || *end != '\0' || errno || *number > MAX;
+}
+
+static unsigned resolveServer(struct load *const load, const char *const SERVER){
+        char host[256];
+        const char *const SEPARATOR = strrchr(SERVER, ':');
+        if(!SEPARATOR || (size_t)(SEPARATOR - SERVER) >= sizeof(host)){
+                fprintf(stderr, "*** Error: Server \"%s\" is not of the form HOST:PORT\n", SERVER);
+                return 1;
+        }
+        memcpy(host, SERVER, SEPARATOR - SERVER);
+        host[SEPARATOR - SERVER] = '\0';
+
+        const struct addrinfo HINTS = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+        struct addrinfo *server;
+        const int ERROR = getaddrinfo(host, SEPARATOR + 1, &HINTS, &server);
+        if(ERROR){
+                fprintf(stderr, "*** Error: Unable to resolve server \"%s\": %s\n", SERVER, gai_strerror(ERROR));
+                return 1;
+        }
+        memcpy(&load->server, server->ai_addr, server->ai_addrlen);
+        load->length = server->ai_addrlen;
+        load->port = ntohs(server->ai_family == AF_INET6 ? ((struct sockaddr_in6 *)server->ai_addr)->sin6_port : ((struct sockaddr_in *)server->ai_addr)->sin_port);
+        freeaddrinfo(server);
+
+        return 0;
+}
+
+/* Ticks at the server's rate, and otherwise drains the socket */
+static void *runThread(void *const argument){
+        struct thread *const thread = argument;
+
+        uint64_t next = nanoseconds();
+        while(!__atomic_load_n(&thread->load->stop, __ATOMIC_ACQUIRE)){
+                uint64_t now = nanoseconds();
+                if(now >= next){
+                        tickGames(thread, now);
+                        next = (now - next < TICK_PERIOD) ? next + TICK_PERIOD : now + TICK_PERIOD;
+                }
+
+                struct pollfd poll_fd = { .fd = thread->fd, .events = POLLIN };
+                poll(&poll_fd, 1, (next - now)/1000000 + 1);
+
+                unsigned char packet[PROTOCOL_MAX_PACKET];
+                ssize_t size;
+                while((size = recv(thread->fd, packet, sizeof(packet), 0)) >= 0){
+                        now = nanoseconds();
+                        handlePacket(thread, packet, size, now);
+                }
+        }
+
+        return NULL;
+}
+
+static void sendPacket(const struct thread *const THREAD, const unsigned PORT, const unsigned char *const DATA, const size_t SIZE){
+        struct sockaddr_storage address = THREAD->load->server;
+        if(address.ss_family == AF_INET6){
+                ((struct sockaddr_in6 *)&address)->sin6_port = htons(PORT);
+        }else{
+                ((struct sockaddr_in *)&address)->sin_port = htons(PORT);
+        }
+        sendto(THREAD->fd, DATA, SIZE, 0, (struct sockaddr *)&address, THREAD->load->length);
+}
+
+static void sleepSeconds(const unsigned SECONDS){
+        struct timespec wait = { .tv_sec = SECONDS };
+        while(nanosleep(&wait, &wait) && errno == EINTR);
+}
+
+/* Hands over the stage if a new epoch has begun, then has both players
+ * of each match join until accepted, and after that send an input each
+ * tick that chases the ball as of the newest state */
+static void tickGames(struct thread *const thread, const uint64_t NOW){
+        const struct load *const LOAD = thread->load;
+
+        const uint32_t EPOCH = __atomic_load_n(&LOAD->epoch, __ATOMIC_ACQUIRE);
+        const unsigned TARGET = __atomic_load_n(&LOAD->target, __ATOMIC_ACQUIRE);
+        const unsigned COUNT = (TARGET + LOAD->count - 1 - thread->id)/LOAD->count;
+        if(EPOCH != thread->reported){
+                thread->report = thread->current;
+                thread->report.playing = 0;
+                for(unsigned i = 0; i < COUNT; i++){
+                        thread->report.playing += thread->games[i].players[0].accepted && thread->games[i].players[1].accepted;
+                }
+                memset(&thread->current, 0, sizeof(thread->current));
+                __atomic_store_n(&thread->reported, EPOCH, __ATOMIC_RELEASE);
+        }
+
+        for(unsigned i = 0; i < COUNT; i++){
+                struct game *const game = &thread->games[i];
+                for(unsigned j = 0; j < 2; j++){
+                        struct side *const player = &game->players[j];
+                        unsigned char packet[PROTOCOL_MAX_PACKET];
+                        if(!player->accepted){
+                                sendPacket(thread, player->port, packet, writeJoin(packet, game->key, j + 1));
+                                continue;
+                        }
+
+                        const struct protocol_state *const STATE = &player->states[player->newest % PROTOCOL_HISTORY];
+                        const int BALL_CENTER = STATE->fields[PROTOCOL_BALL_Y] + BALL_HEIGHT/2;
+                        const int PADDLE_CENTER = STATE->fields[j ? PROTOCOL_PADDLE2_Y : PROTOCOL_PADDLE1_Y] + PADDLE_HEIGHT/2;
+                        const int Y_VEL = (BALL_CENTER > PADDLE_CENTER + 10) ? PROTOCOL_PADDLE_SPEED : ((BALL_CENTER < PADDLE_CENTER - 10) ? -PROTOCOL_PADDLE_SPEED : 0);
+                        player->sequence++;
+                        player->sent[player->sequence % LOAD_INPUTS] = NOW;
+                        sendPacket(thread, player->port, packet, writeInput(packet, game->key, j + 1, player->sequence, player->newest, Y_VEL));
+                }
+        }
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "bot.h"
+#include "match.h"
+#include "pool.h"
+#include "world.h"
+
+struct match_batch{
+        uint64_t base;
+        unsigned points;
+        unsigned bot_level;
+        struct match_result *results;
+};
+
+static void playBatchMatch(void *const context, const unsigned INDEX);
+
+/* Seeds are scrambled so that neighbouring matches do not play out
+ * overlapping stretches of the same random sequence */
+uint64_t matchSeed(const uint64_t BASE, const unsigned INDEX){
+        /* the number after the first INDEX of the sequence from BASE */
+        uint64_t state = BASE + INDEX*0x9E3779B97F4A7C15u;
+        return mixRandom(&state);
+}
+
+/* With a BOT_LEVEL, the right paddle is played by the bot instead */
+void playMatch(const uint64_t SEED, const unsigned POINTS, const unsigned BOT_LEVEL, struct match_result *const result){
+        struct world world = WORLD_INITIALIZER;
+        initWorld(&world, SEED);
+        struct bot bot;
+        if(BOT_LEVEL){
+                initBot(&bot, BOT_LEVEL, SEED ^ MATCH_BOT_SEED);
+        }
+
+        *result = (struct match_result){ .ticks = 0 };
+        unsigned rally = 0;
+        while(world.player1.score < POINTS && world.player2.score < POINTS && result->ticks < MATCH_MAX_TICKS){
+                trackBall(&world.player1, &world.ball);
+                if(BOT_LEVEL){
+                        driveBot(&bot, &world.player2, &world.ball);
+                }else{
+                        trackBall(&world.player2, &world.ball);
+                }
+                const unsigned EVENTS = stepWorld(&world);
+                result->ticks++;
+
+                /* one tick may hold both a hit and a point, as when the ball
+                 * glances off a paddle's edge into the goal behind it */
+                if(EVENTS & (WORLD_HIT_PLAYER1 | WORLD_HIT_PLAYER2)){
+                        result->hits++;
+                        rally++;
+                }
+                if(EVENTS & (WORLD_SCORE_PLAYER1 | WORLD_SCORE_PLAYER2)){
+                        result->rallies++;
+                        if(rally > result->longest_rally){
+                                result->longest_rally = rally;
+                        }
+                        rally = 0;
+                }
+        }
+
+        result->score1 = world.player1.score;
+        result->score2 = world.player2.score;
+}
+
+/* Each match writes only its own slot of results, so the outcome is the
+ * same whichever thread happens to play it */
+unsigned playMatches(const unsigned COUNT, const unsigned THREADS, const uint64_t BASE, const unsigned POINTS, const unsigned BOT_LEVEL, struct match_result *const results){
+        struct match_batch batch = { .base = BASE, .points = POINTS, .bot_level = BOT_LEVEL, .results = results };
+
+        return runPool(COUNT, THREADS, playBatchMatch, &batch);
+}
+
+/* Simple stand-in for a human player: chase the ball only once it is
+ * approaching within the player's half, so that rallies can be lost */
+void trackBall(struct player *const player, const struct character *const ball){
+        const int BALL_CENTER = ball->box.y + ball->box.h/2;
+        const int PADDLE_CENTER = player->avatar.box.y + player->avatar.box.h/2;
+        const unsigned LEFT_SIDE = player->avatar.box.x < WIDTH/2;
+        const unsigned APPROACHING = (ball->x_vel < 0) == LEFT_SIDE && (ball->box.x < WIDTH/2) == LEFT_SIDE;
+
+        if(!APPROACHING || (BALL_CENTER > PADDLE_CENTER - 10 && BALL_CENTER < PADDLE_CENTER + 10)){
+                player->avatar.y_vel = 0;
+        }else{
+                player->avatar.y_vel = (BALL_CENTER > PADDLE_CENTER) ? 10 : -10;
+        }
+}
+
+static void playBatchMatch(void *const context, const unsigned INDEX){
+        const struct match_batch *const BATCH = context;
+
+        playMatch(matchSeed(BATCH->base, INDEX), BATCH->points, BATCH->bot_level, &BATCH->results[INDEX]);
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <stdint.h>
+
+#include "world.h"
+
+/* A match ends once either player reaches the target score, or after
+ * this many ticks should the players never miss */
+#define MATCH_MAX_TICKS 1000000ul
+
+/* Mixed into a match seed to seed its bot, if any */
+#define MATCH_BOT_SEED 0xB07B07B07B07B07Bu
+
+/* A rally is the run of paddle hits between a serve and the next point */
+struct match_result{
+        unsigned score1;
+        unsigned score2;
+        unsigned long ticks;
+        unsigned long hits;
+        unsigned rallies;
+        unsigned longest_rally;
+};
+
+uint64_t matchSeed(const uint64_t BASE, const unsigned INDEX);
+void playMatch(const uint64_t SEED, const unsigned POINTS, const unsigned BOT_LEVEL, struct match_result *const result);
+unsigned playMatches(const unsigned COUNT, const unsigned THREADS, const uint64_t BASE, const unsigned POINTS, const unsigned BOT_LEVEL, struct match_result *const results);
+void trackBall(struct player *const player, const struct character *const ball);
+
+#endif
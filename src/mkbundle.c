@@ -0,0 +1,135 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "atlas.h"
+#include "bundle.h"
+
+static unsigned writeBundle(const char *const PATH, SDL_Surface *const surface, const struct atlas *const atlas);
+
+/* Build-time tool: decodes the media files once and writes the packed
+ * sprite atlas as a bundle which the game maps directly into memory */
+int main(int argc, char *argv[]){
+        if(argc != 3){
+                fprintf(stderr, "Usage: %s MEDIA_DIR OUTPUT\n", argv[0]);
+                return 1;
+        }
+
+        SDL_Surface *surfaces[ATLAS_ENTRIES] = { NULL };
+        if(loadAtlasSurfaces(argv[1], surfaces)){
+                fprintf(stderr, "*** Error: Unable to load media files from \"%s\"\n", argv[1]);
+                goto err_load_surfaces;
+        }
+
+        struct atlas atlas;
+        SDL_Surface *const surface = packAtlas(surfaces, &atlas);
+        if(!surface){
+                fprintf(stderr, "*** Error: Unable to pack sprite atlas\n");
+                goto err_pack_atlas;
+        }
+
+        if(writeBundle(argv[2], surface, &atlas)){
+                fprintf(stderr, "*** Error: Unable to write bundle \"%s\"\n", argv[2]);
+                goto err_write_bundle;
+        }
+
+        SDL_FreeSurface(surface);
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+        SDL_Quit();
+
+        return 0;
+
+err_write_bundle:
+        SDL_FreeSurface(surface);
+err_pack_atlas:
+err_load_surfaces:
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                SDL_FreeSurface(surfaces[i]);
+        }
+        SDL_Quit();
+        return 1;
+}
+
+static unsigned writeBundle(const char *const PATH, SDL_Surface *const surface, const struct atlas *const atlas){
+        static const char PADDING[BUNDLE_ALIGN];
+        struct bundle_header header = {
+                .version = BUNDLE_VERSION,
+                .format = surface->format->format,
+                .w = atlas->w,
+                .h = atlas->h,
+                .pitch = surface->pitch,
+                .offset = (sizeof(header) + BUNDLE_ALIGN - 1)/BUNDLE_ALIGN*BUNDLE_ALIGN,
+                .entries = ATLAS_ENTRIES
+        };
+        memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+        for(unsigned i = 0; i < ATLAS_ENTRIES; i++){
+                const SDL_Rect *const RECT = &atlas->rects[i];
+                header.rects[i] = (struct bundle_rect){ .x = RECT->x, .y = RECT->y, .w = RECT->w, .h = RECT->h };
+        }
+
+        FILE *const file = fopen(PATH, "wb");
+        if(!file){
+                perror(PATH);
+                return 1;
+        }
+
+        if(fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(PADDING, 1, header.offset - sizeof(header), file) != header.offset - sizeof(header)){
+                perror(PATH);
+                goto err_write;
+        }
+
+        if(SDL_LockSurface(surface)){
+                fprintf(stderr, "*** Error: Unable to lock atlas surface: %s\n", SDL_GetError());
+                goto err_lock_surface;
+        }
+        const size_t WRITTEN = fwrite(surface->pixels, surface->pitch, surface->h, file);
+        SDL_UnlockSurface(surface);
+        if(WRITTEN != (size_t)surface->h){
+                perror(PATH);
+                goto err_write;
+        }
+
+        if(fclose(file)){
+                perror(PATH);
+                remove(PATH);
+                return 1;
+        }
+
+        return 0;
+
+err_lock_surface:
+err_write:
+        fclose(file);
+        remove(PATH);
+        return 1;
+}
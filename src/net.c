@@ -0,0 +1,214 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "net.h"
+
+static uint64_t milliseconds(void);
+static uint32_t nextRandom(struct net *const net);
+static unsigned transmit(struct net *const net, const void *const DATA, const size_t SIZE);
+
+void closeNet(struct net *const net){
+        close(net->fd);
+}
+
+/* Sends every delayed packet that has come due */
+unsigned flushNet(struct net *const net){
+        const uint64_t NOW = milliseconds();
+
+        unsigned kept = 0;
+        for(unsigned i = 0; i < net->queued; i++){
+                const struct net_packet *const PACKET = &net->queue[i];
+                if(PACKET->due > NOW){
+                        net->queue[kept++] = *PACKET;
+                }else if(transmit(net, PACKET->data, PACKET->size)){
+                        return 1;
+                }
+        }
+        net->queued = kept;
+
+        return 0;
+}
+
+/* PEER is given as HOST:PORT; the socket is connected to it, so that
+ * datagrams from anywhere else are discarded by the kernel */
+unsigned openNet(struct net *const net, const char *const PORT, const char *const PEER, const struct net_shim *const SHIM){
+        char host[256];
+        const char *const SEPARATOR = strrchr(PEER, ':');
+        if(!SEPARATOR || (size_t)(SEPARATOR - PEER) >= sizeof(host)){
+                fprintf(stderr, "*** Error: Peer \"%s\" is not of the form HOST:PORT\n", PEER);
+                return 1;
+        }
+        memcpy(host, PEER, SEPARATOR - PEER);
+        host[SEPARATOR - PEER] = '\0';
+
+        const struct addrinfo HINTS = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+        struct addrinfo *peer;
+        int error = getaddrinfo(host, SEPARATOR + 1, &HINTS, &peer);
+        if(error){
+                fprintf(stderr, "*** Error: Unable to resolve peer \"%s\": %s\n", PEER, gai_strerror(error));
+                return 1;
+        }
+
+        const struct addrinfo LOCAL_HINTS = { .ai_family = peer->ai_family, .ai_socktype = SOCK_DGRAM, .ai_flags = AI_PASSIVE };
+        struct addrinfo *local;
+        error = getaddrinfo(NULL, PORT, &LOCAL_HINTS, &local);
+        if(error){
+                fprintf(stderr, "*** Error: Unable to resolve local port \"%s\": %s\n", PORT, gai_strerror(error));
+                goto err_local;
+        }
+
+        net->fd = socket(local->ai_family, SOCK_DGRAM, 0);
+        if(net->fd < 0){
+                fprintf(stderr, "*** Error: Unable to create socket: %s\n", strerror(errno));
+                goto err_socket;
+        }
+        if(fcntl(net->fd, F_SETFL, O_NONBLOCK)){
+                fprintf(stderr, "*** Error: Unable to make socket non-blocking: %s\n", strerror(errno));
+                goto err_fcntl;
+        }
+        if(bind(net->fd, local->ai_addr, local->ai_addrlen)){
+                fprintf(stderr, "*** Error: Unable to bind to port %s: %s\n", PORT, strerror(errno));
+                goto err_bind;
+        }
+        if(connect(net->fd, peer->ai_addr, peer->ai_addrlen)){
+                fprintf(stderr, "*** Error: Unable to connect to peer \"%s\": %s\n", PEER, strerror(errno));
+                goto err_connect;
+        }
+
+        freeaddrinfo(local);
+        freeaddrinfo(peer);
+
+        net->shim = *SHIM;
+        net->rng = (0x9E3779B9u ^ (uint32_t)milliseconds()) | 1;
+        net->queued = 0;
+        net->sent = 0;
+        net->dropped = 0;
+
+        return 0;
+
+err_connect:
+err_bind:
+err_fcntl:
+        close(net->fd);
+err_socket:
+        freeaddrinfo(local);
+err_local:
+        freeaddrinfo(peer);
+        return 1;
+}
+
+/* Sets *received to zero when no datagram is waiting */
+unsigned receiveNet(struct net *const net, void *const buffer, const size_t SIZE, size_t *const received){
+        const ssize_t RECEIVED = recv(net->fd, buffer, SIZE, 0);
+        if(RECEIVED < 0){
+                *received = 0;
+                /* A peer that is not up yet shows up as a refused send */
+                if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED){
+                        return 0;
+                }
+                fprintf(stderr, "*** Error: Unable to receive from peer: %s\n", strerror(errno));
+                return 1;
+        }
+
+        *received = RECEIVED;
+        return 0;
+}
+
+unsigned sendNet(struct net *const net, const void *const DATA, const size_t SIZE){
+        if(SIZE > NET_MAX_PACKET){
+                fprintf(stderr, "*** Error: Packet of %zu bytes is too large\n", SIZE);
+                return 1;
+        }
+
+        if(net->shim.loss && nextRandom(net) % 100 < net->shim.loss){
+                net->dropped++;
+                return 0;
+        }
+
+        if(!net->shim.latency && !net->shim.jitter){
+                return transmit(net, DATA, SIZE);
+        }
+
+        if(net->queued == NET_QUEUE){
+                net->dropped++;
+                return 0;
+        }
+        struct net_packet *const packet = &net->queue[net->queued++];
+        packet->due = milliseconds() + net->shim.latency + (net->shim.jitter ? nextRandom(net) % (net->shim.jitter + 1) : 0);
+        packet->size = SIZE;
+        memcpy(packet->data, DATA, SIZE);
+
+        return 0;
+}
+
+/* Returns nonzero only on error; a timeout is not one */
+unsigned waitNet(struct net *const net, const unsigned TIMEOUT){
+        struct pollfd pollfd = { .fd = net->fd, .events = POLLIN };
+        if(poll(&pollfd, 1, TIMEOUT) < 0 && errno != EINTR){
+                fprintf(stderr, "*** Error: Unable to wait for peer: %s\n", strerror(errno));
+                return 1;
+        }
+
+        return 0;
+}
+
+static uint64_t milliseconds(void){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t)now.tv_sec*1000 + now.tv_nsec/1000000;
+}
+
+/* xorshift32 */
+static uint32_t nextRandom(struct net *const net){
+        uint32_t x = net->rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return net->rng = x;
+}
+
+static unsigned transmit(struct net *const net, const void *const DATA, const size_t SIZE){
+        if(send(net->fd, DATA, SIZE, 0) < 0 && errno != ECONNREFUSED && errno != EAGAIN && errno != EWOULDBLOCK){
+                fprintf(stderr, "*** Error: Unable to send to peer: %s\n", strerror(errno));
+                return 1;
+        }
+        net->sent++;
+
+        return 0;
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NET_MAX_PACKET 128
+#define NET_QUEUE 256
+
+/* Artificial network conditions applied to outgoing packets, so that
+ * a game over localhost behaves like one over a real link */
+struct net_shim{
+        unsigned latency;
+        unsigned jitter;
+        unsigned loss;
+};
+
+struct net_packet{
+        uint64_t due;
+        size_t size;
+        unsigned char data[NET_MAX_PACKET];
+};
+
+struct net{
+        int fd;
+        struct net_shim shim;
+        uint32_t rng;
+        unsigned queued;
+        unsigned long sent;
+        unsigned long dropped;
+        struct net_packet queue[NET_QUEUE];
+};
+
+void closeNet(struct net *const net);
+unsigned flushNet(struct net *const net);
+unsigned openNet(struct net *const net, const char *const PORT, const char *const PEER, const struct net_shim *const SHIM);
+unsigned receiveNet(struct net *const net, void *const buffer, const size_t SIZE, size_t *const received);
+unsigned sendNet(struct net *const net, const void *const DATA, const size_t SIZE);
+unsigned waitNet(struct net *const net, const unsigned TIMEOUT);
+
+#endif
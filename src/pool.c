@@ -0,0 +1,159 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+#define RANGE(BEGIN, END) ((uint64_t)(BEGIN) << 32 | (END))
+#define RANGE_BEGIN(RANGE) ((uint32_t)((RANGE) >> 32))
+#define RANGE_END(RANGE) ((uint32_t)(RANGE))
+
+/* Each worker owns a contiguous range of job indices, packed into one
+ * word so that taking from the front (the owner) and splitting off the
+ * back half (a thief) are both a single compare-and-swap */
+struct worker{
+        uint64_t range;
+        pthread_t thread;
+        struct pool *pool;
+        unsigned id;
+} __attribute__((aligned(64)));
+
+struct pool{
+        struct worker *workers;
+        unsigned threads;
+        pool_job_fn job;
+        void *context;
+};
+
+static unsigned stealRange(struct worker *const thief);
+static unsigned takeIndex(struct worker *const worker, unsigned *const index);
+static void *workLoop(void *const argument);
+
+unsigned onlineProcessors(void){
+        const long PROCESSORS = sysconf(_SC_NPROCESSORS_ONLN);
+
+        return (PROCESSORS > 0) ? PROCESSORS : 1;
+}
+
+unsigned runPool(const unsigned JOBS, const unsigned THREADS, const pool_job_fn job, void *const context){
+        struct pool pool = { .threads = THREADS, .job = job, .context = context };
+        if(posix_memalign((void **)&pool.workers, 64, sizeof(*pool.workers)*THREADS)){
+                fprintf(stderr, "*** Error: Unable to allocate %u workers\n", THREADS);
+                return 1;
+        }
+        memset(pool.workers, 0, sizeof(*pool.workers)*THREADS);
+
+        for(unsigned i = 0; i < THREADS; i++){
+                struct worker *const worker = &pool.workers[i];
+                worker->range = RANGE((uint64_t)JOBS*i/THREADS, (uint64_t)JOBS*(i + 1)/THREADS);
+                worker->pool = &pool;
+                worker->id = i;
+        }
+
+        /* The calling thread works as worker 0 */
+        unsigned started;
+        for(started = 1; started < THREADS; started++){
+                if(pthread_create(&pool.workers[started].thread, NULL, workLoop, &pool.workers[started])){
+                        fprintf(stderr, "*** Error: Unable to start worker thread %u\n", started);
+                        break;
+                }
+        }
+        workLoop(&pool.workers[0]);
+
+        for(unsigned i = 1; i < started; i++){
+                pthread_join(pool.workers[i].thread, NULL);
+        }
+
+        /* Ranges of workers that failed to start were stolen by the rest */
+        free(pool.workers);
+
+        return 0;
+}
+
+/* Takes the back half of the fullest range among the other workers */
+static unsigned stealRange(struct worker *const thief){
+        struct pool *const pool = thief->pool;
+
+        for(;;){
+                struct worker *victim = NULL;
+                uint64_t victim_range = 0;
+                uint32_t most = 0;
+                for(unsigned i = 1; i < pool->threads; i++){
+                        struct worker *const worker = &pool->workers[(thief->id + i) % pool->threads];
+                        const uint64_t RANGE = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+                        const uint32_t SIZE = RANGE_END(RANGE) - RANGE_BEGIN(RANGE);
+                        if(RANGE_BEGIN(RANGE) < RANGE_END(RANGE) && SIZE > most){
+                                victim = worker;
+                                victim_range = RANGE;
+                                most = SIZE;
+                        }
+                }
+                if(!victim){
+                        return 1;
+                }
+
+                const uint32_t BEGIN = RANGE_BEGIN(victim_range);
+                const uint32_t END = RANGE_END(victim_range);
+                const uint32_t MIDDLE = BEGIN + (END - BEGIN)/2;
+                if(__atomic_compare_exchange_n(&victim->range, &victim_range, RANGE(BEGIN, MIDDLE), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+                        __atomic_store_n(&thief->range, RANGE(MIDDLE, END), __ATOMIC_RELEASE);
+                        return 0;
+                }
+        }
+}
+
+static unsigned takeIndex(struct worker *const worker, unsigned *const index){
+        uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+        while(RANGE_BEGIN(range) < RANGE_END(range)){
+                if(__atomic_compare_exchange_n(&worker->range, &range, RANGE(RANGE_BEGIN(range) + 1, RANGE_END(range)), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+                        *index = RANGE_BEGIN(range);
+                        return 0;
+                }
+        }
+
+        return 1;
+}
+
+static void *workLoop(void *const argument){
+        struct worker *const worker = argument;
+        struct pool *const pool = worker->pool;
+
+        do{
+                unsigned index;
+                while(!takeIndex(worker, &index)){
+                        pool->job(pool->context, index);
+                }
+        }while(!stealRange(worker));
+
+        return NULL;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "histogram.h"
+#include "profile.h"
+
+const char *const PROFILE_PHASE_NAMES[PROFILE_PHASES] = {
+        [PROFILE_EVENTS] = "events",
+        [PROFILE_SIMULATE] = "simulate",
+        [PROFILE_DRAW] = "draw",
+        [PROFILE_PRESENT] = "present",
+        [PROFILE_SLEEP] = "sleep"
+};
+
+void endFrame(struct profile *const profile){
+        if(!profile->enabled){
+                return;
+        }
+
+        profile->frames[profile->frame_count++ % PROFILE_FRAMES] = profile->current;
+        for(unsigned i = 0; i < PROFILE_PHASES; i++){
+                recordHistogram(&profile->histograms[i], profile->current.phases[i]);
+        }
+}
+
+void initProfile(struct profile *const profile){
+        memset(profile, 0, sizeof(*profile));
+        profile->frequency = SDL_GetPerformanceFrequency();
+}
+
+/* Charges the time since the previous mark to PHASE; when profiling is
+ * off this is the only cost, and it does not even read the clock */
+void markPhase(struct profile *const profile, const enum profile_phase PHASE){
+        if(!profile->enabled){
+                return;
+        }
+
+        const Uint64 NOW = SDL_GetPerformanceCounter();
+        const uint64_t NS = (NOW - profile->mark)*1000000000u/profile->frequency;
+        profile->current.phases[PHASE] += (NS > UINT32_MAX - profile->current.phases[PHASE]) ? UINT32_MAX - profile->current.phases[PHASE] : NS;
+        profile->mark = NOW;
+}
+
+void recentMaxima(const struct profile *const profile, struct profile_frame *const maxima){
+        const uint64_t FRAMES = (profile->frame_count < PROFILE_FRAMES) ? profile->frame_count : PROFILE_FRAMES;
+
+        memset(maxima, 0, sizeof(*maxima));
+        for(uint64_t i = 0; i < FRAMES; i++){
+                for(unsigned j = 0; j < PROFILE_PHASES; j++){
+                        if(profile->frames[i].phases[j] > maxima->phases[j]){
+                                maxima->phases[j] = profile->frames[i].phases[j];
+                        }
+                }
+        }
+}
+
+void startFrame(struct profile *const profile){
+        if(!profile->enabled){
+                return;
+        }
+
+        memset(&profile->current, 0, sizeof(profile->current));
+        profile->mark = SDL_GetPerformanceCounter();
+}
+
+unsigned writeProfile(const struct profile *const profile, const char *const PATH){
+        FILE *const file = fopen(PATH, "w");
+        if(!file){
+                fprintf(stderr, "*** Error: Unable to create profile \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        fprintf(file, "phase,frames,p50_ms,p99_ms,max_ms\n");
+        for(unsigned i = 0; i < PROFILE_PHASES; i++){
+                const struct histogram *const HISTOGRAM = &profile->histograms[i];
+                fprintf(file, "%s,%llu,%.4f,%.4f,%.4f\n", PROFILE_PHASE_NAMES[i], (unsigned long long)HISTOGRAM->count,
+                        histogramPercentile(HISTOGRAM, 50)/1e6, histogramPercentile(HISTOGRAM, 99)/1e6, HISTOGRAM->max/1e6);
+        }
+
+        if(fclose(file)){
+                fprintf(stderr, "*** Error: Unable to write profile \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        return 0;
+}
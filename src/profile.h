@@ -0,0 +1,74 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "SDL.h"
+
+#include "histogram.h"
+
+#define PROFILE_FRAMES 1024
+
+enum profile_phase{
+        PROFILE_EVENTS,
+        PROFILE_SIMULATE,
+        PROFILE_DRAW,
+        PROFILE_PRESENT,
+        PROFILE_SLEEP,
+        PROFILE_PHASES
+};
+
+/* Phase durations of one frame, in nanoseconds */
+struct profile_frame{
+        uint32_t phases[PROFILE_PHASES];
+};
+
+/* Only the main loop writes to a profile, so no locking is needed; the
+ * most recent PROFILE_FRAMES frames are kept in a ring */
+struct profile{
+        unsigned enabled;
+        Uint64 frequency;
+        Uint64 mark;
+        struct profile_frame current;
+        uint64_t frame_count;
+        struct profile_frame frames[PROFILE_FRAMES];
+        struct histogram histograms[PROFILE_PHASES];
+};
+
+extern const char *const PROFILE_PHASE_NAMES[PROFILE_PHASES];
+
+void endFrame(struct profile *const profile);
+void initProfile(struct profile *const profile);
+void markPhase(struct profile *const profile, const enum profile_phase PHASE);
+void recentMaxima(const struct profile *const profile, struct profile_frame *const maxima);
+void startFrame(struct profile *const profile);
+unsigned writeProfile(const struct profile *const profile, const char *const PATH);
+
+#endif
@@ -0,0 +1,190 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "protocol.h"
+#include "world.h"
+
+#define JOIN_SIZE 8
+#define WELCOME_SIZE 14
+#define INPUT_SIZE 17
+#define STATE_HEADER_SIZE 22
+
+static uint16_t get16(const unsigned char *const DATA);
+static uint32_t get32(const unsigned char *const DATA);
+static size_t putHeader(unsigned char *const data, const enum protocol_packet TYPE, const uint32_t KEY, const unsigned PLAYER);
+static void put16(unsigned char *const data, const uint16_t VALUE);
+static void put32(unsigned char *const data, const uint32_t VALUE);
+
+/* BASE must be the state of the tick MESSAGE names as its base, or NULL
+ * for a base of zero */
+void applyState(const struct protocol_message *const MESSAGE, const struct protocol_state *const BASE, struct protocol_state *const state){
+        state->tick = MESSAGE->state.tick;
+        for(unsigned i = 0; i < PROTOCOL_FIELDS; i++){
+                state->fields[i] = (MESSAGE->mask >> i & 1) ? MESSAGE->state.fields[i] : (BASE ? BASE->fields[i] : 0);
+        }
+}
+
+/* Returns nonzero for anything that is not a well-formed packet */
+unsigned readMessage(const unsigned char *const DATA, const size_t SIZE, struct protocol_message *const message){
+        if(SIZE < JOIN_SIZE || get16(DATA) != PROTOCOL_MAGIC || DATA[3] < 1 || DATA[3] > 2){
+                return 1;
+        }
+        message->type = DATA[2];
+        message->player = DATA[3];
+        message->key = get32(DATA + 4);
+
+        switch(message->type){
+                case PROTOCOL_JOIN:
+                        return SIZE != JOIN_SIZE;
+                case PROTOCOL_WELCOME:
+                        if(SIZE != WELCOME_SIZE){
+                                return 1;
+                        }
+                        message->flags = DATA[8];
+                        message->workers = get16(DATA + 10);
+                        message->port = get16(DATA + 12);
+                        return 0;
+                case PROTOCOL_INPUT:
+                        if(SIZE != INPUT_SIZE){
+                                return 1;
+                        }
+                        message->sequence = get32(DATA + 8);
+                        message->ack = get32(DATA + 12);
+                        message->y_vel = (int8_t)DATA[16];
+                        return 0;
+                case PROTOCOL_STATE:
+                        if(SIZE < STATE_HEADER_SIZE || SIZE != STATE_HEADER_SIZE + 2*(size_t)__builtin_popcount(DATA[9])){
+                                return 1;
+                        }
+                        message->flags = DATA[8];
+                        message->mask = DATA[9];
+                        message->state.tick = get32(DATA + 10);
+                        message->base = get32(DATA + 14);
+                        message->sequence = get32(DATA + 18);
+                        const unsigned char *value = DATA + STATE_HEADER_SIZE;
+                        for(unsigned i = 0; i < PROTOCOL_FIELDS; i++){
+                                if(message->mask >> i & 1){
+                                        message->state.fields[i] = (int16_t)get16(value);
+                                        value += 2;
+                                }
+                        }
+                        return 0;
+        }
+
+        return 1;
+}
+
+void worldState(const struct world *const WORLD, const uint32_t TICK, struct protocol_state *const state){
+        state->tick = TICK;
+        state->fields[PROTOCOL_BALL_X] = WORLD->ball.box.x;
+        state->fields[PROTOCOL_BALL_Y] = WORLD->ball.box.y;
+        state->fields[PROTOCOL_BALL_X_VEL] = WORLD->ball.x_vel;
+        state->fields[PROTOCOL_BALL_Y_VEL] = WORLD->ball.y_vel;
+        state->fields[PROTOCOL_PADDLE1_Y] = WORLD->player1.avatar.box.y;
+        state->fields[PROTOCOL_PADDLE2_Y] = WORLD->player2.avatar.box.y;
+        state->fields[PROTOCOL_SCORE1] = WORLD->player1.score;
+        state->fields[PROTOCOL_SCORE2] = WORLD->player2.score;
+}
+
+size_t writeInput(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const uint32_t SEQUENCE, const uint32_t ACK, const int Y_VEL){
+        putHeader(data, PROTOCOL_INPUT, KEY, PLAYER);
+        put32(data + 8, SEQUENCE);
+        put32(data + 12, ACK);
+        data[16] = (uint8_t)(int8_t)Y_VEL;
+
+        return INPUT_SIZE;
+}
+
+size_t writeJoin(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER){
+        return putHeader(data, PROTOCOL_JOIN, KEY, PLAYER);
+}
+
+/* Only the fields of STATE that differ from BASE, or from zero if BASE
+ * is NULL, are written; a rally between paddle hits mostly changes just
+ * the ball's position and a paddle */
+size_t writeState(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const unsigned FLAGS, const uint32_t SEQUENCE, const struct protocol_state *const STATE, const struct protocol_state *const BASE){
+        putHeader(data, PROTOCOL_STATE, KEY, PLAYER);
+        data[8] = FLAGS;
+        put32(data + 10, STATE->tick);
+        put32(data + 14, BASE ? BASE->tick : 0);
+        put32(data + 18, SEQUENCE);
+
+        unsigned mask = 0;
+        size_t size = STATE_HEADER_SIZE;
+        for(unsigned i = 0; i < PROTOCOL_FIELDS; i++){
+                if(STATE->fields[i] != (BASE ? BASE->fields[i] : 0)){
+                        mask |= 1u << i;
+                        put16(data + size, (uint16_t)STATE->fields[i]);
+                        size += 2;
+                }
+        }
+        data[9] = mask;
+
+        return size;
+}
+
+size_t writeWelcome(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const unsigned FLAGS, const unsigned WORKERS, const unsigned PORT){
+        putHeader(data, PROTOCOL_WELCOME, KEY, PLAYER);
+        data[8] = FLAGS;
+        data[9] = 0;
+        put16(data + 10, WORKERS);
+        put16(data + 12, PORT);
+
+        return WELCOME_SIZE;
+}
+
+static uint16_t get16(const unsigned char *const DATA){
+        return DATA[0] | (uint16_t)DATA[1] << 8;
+}
+
+static uint32_t get32(const unsigned char *const DATA){
+        return DATA[0] | (uint32_t)DATA[1] << 8 | (uint32_t)DATA[2] << 16 | (uint32_t)DATA[3] << 24;
+}
+
+static size_t putHeader(unsigned char *const data, const enum protocol_packet TYPE, const uint32_t KEY, const unsigned PLAYER){
+        put16(data, PROTOCOL_MAGIC);
+        data[2] = TYPE;
+        data[3] = PLAYER;
+        put32(data + 4, KEY);
+
+        return JOIN_SIZE;
+}
+
+static void put16(unsigned char *const data, const uint16_t VALUE){
+        data[0] = VALUE;
+        data[1] = VALUE >> 8;
+}
+
+static void put32(unsigned char *const data, const uint32_t VALUE){
+        data[0] = VALUE;
+        data[1] = VALUE >> 8;
+        data[2] = VALUE >> 16;
+        data[3] = VALUE >> 24;
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "world.h"
+
+#define PROTOCOL_MAGIC 0x4653u
+#define PROTOCOL_MAX_PACKET 64
+
+/* Ticks of state a match keeps as bases for deltas; a client that has
+ * acknowledged nothing more recent is sent the whole state again */
+#define PROTOCOL_HISTORY 32
+
+#define PROTOCOL_PADDLE_SPEED 10
+
+/* Flags of a welcome and of a state, respectively */
+#define PROTOCOL_ACCEPTED 0x1u
+#define PROTOCOL_FINISHED 0x1u
+
+/* Packets start with the magic and a type byte; integers are
+ * little-endian. A client joins match KEY as PLAYER with a join, and is
+ * welcomed with the number of server workers and the port of the one
+ * hosting the match, where it must join again unless it was accepted.
+ * An input carries a sequence number, the paddle's y_vel and the
+ * newest state tick the player has received. A state carries the tick,
+ * the sequence of the last input applied, and the fields that differ
+ * from those of the base tick, which is one the player acknowledged, or
+ * zero for a state of all zeroes. */
+enum protocol_packet{
+        PROTOCOL_JOIN,
+        PROTOCOL_WELCOME,
+        PROTOCOL_INPUT,
+        PROTOCOL_STATE
+};
+
+enum protocol_field{
+        PROTOCOL_BALL_X,
+        PROTOCOL_BALL_Y,
+        PROTOCOL_BALL_X_VEL,
+        PROTOCOL_BALL_Y_VEL,
+        PROTOCOL_PADDLE1_Y,
+        PROTOCOL_PADDLE2_Y,
+        PROTOCOL_SCORE1,
+        PROTOCOL_SCORE2,
+        PROTOCOL_FIELDS
+};
+
+/* What a player is shown of a match as of a tick */
+struct protocol_state{
+        uint32_t tick;
+        int16_t fields[PROTOCOL_FIELDS];
+};
+
+/* A packet as read; only the members its type carries are set. A state
+ * is left as read, with MASK telling which of the FIELDS it holds, for
+ * applyState() to fill in from the base. */
+struct protocol_message{
+        enum protocol_packet type;
+        unsigned player;
+        uint32_t key;
+        unsigned flags;
+        unsigned workers;
+        unsigned port;
+        uint32_t sequence;
+        uint32_t ack;
+        int y_vel;
+        uint32_t base;
+        unsigned mask;
+        struct protocol_state state;
+};
+
+void applyState(const struct protocol_message *const MESSAGE, const struct protocol_state *const BASE, struct protocol_state *const state);
+unsigned readMessage(const unsigned char *const DATA, const size_t SIZE, struct protocol_message *const message);
+void worldState(const struct world *const WORLD, const uint32_t TICK, struct protocol_state *const state);
+size_t writeInput(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const uint32_t SEQUENCE, const uint32_t ACK, const int Y_VEL);
+size_t writeJoin(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER);
+size_t writeState(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const unsigned FLAGS, const uint32_t SEQUENCE, const struct protocol_state *const STATE, const struct protocol_state *const BASE);
+size_t writeWelcome(unsigned char *const data, const uint32_t KEY, const unsigned PLAYER, const unsigned FLAGS, const unsigned WORKERS, const unsigned PORT);
+
+#endif
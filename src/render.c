@@ -0,0 +1,352 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "SDL.h"
+
+#include "arena.h"
+#include "atlas.h"
+#include "batch.h"
+#include "field.h"
+#include "profile.h"
+#include "render.h"
+#include "world.h"
+
+#define HUD_X 8
+#define HUD_Y 40
+#define HUD_COLUMN 64
+#define BRICK_RECTS 256
+
+static unsigned drawBricks(const struct scene *const SCENE);
+static unsigned drawHud(const struct scene *const SCENE);
+static unsigned drawLayer(SDL_Renderer *const renderer, const struct scene *const SCENE);
+static unsigned drawScore(const struct scene *const SCENE, const unsigned SCORE, const int X);
+static unsigned drawSprite(const struct scene *const SCENE, const enum atlas_entry ENTRY, const struct box *const box);
+static unsigned drawStatic(const struct scene *const SCENE);
+static unsigned drawText(const struct scene *const SCENE, const char *const TEXT, const int X, const int Y);
+
+/* A frame that needs no atlas: the ball and paddles as plain white
+ * rectangles on black, shown while the sprites are still loading */
+unsigned drawPlaceholder(SDL_Renderer *const renderer, const struct world *const WORLD){
+        if(SDL_RenderClear(renderer) < 0){
+                fprintf(stderr, "*** Error: Unable to clear renderer: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        const struct box *const BOXES[] = { &WORLD->ball.box, &WORLD->player1.avatar.box, &WORLD->player2.avatar.box };
+        SDL_Rect rects[sizeof(BOXES)/sizeof(*BOXES)];
+        for(unsigned i = 0; i < sizeof(BOXES)/sizeof(*BOXES); i++){
+                rects[i] = (SDL_Rect){ .x = BOXES[i]->x, .y = BOXES[i]->y, .w = BOXES[i]->w, .h = BOXES[i]->h };
+        }
+        if(SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255) < 0){
+                fprintf(stderr, "*** Error: Unable to set placeholder color: %s\n", SDL_GetError());
+                return 1;
+        }
+        if(SDL_RenderFillRects(renderer, rects, sizeof(rects)/sizeof(*rects)) < 0){
+                fprintf(stderr, "*** Error: Unable to fill placeholders: %s\n", SDL_GetError());
+                return 1;
+        }
+        if(SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255) < 0){
+                fprintf(stderr, "*** Error: Unable to restore draw color: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        return 0;
+}
+
+/* Every sprite lives in the one atlas texture, so the whole frame is
+ * accumulated into a single batch and submitted with one draw call,
+ * plus one copy of the static layer when it is cached */
+unsigned drawWorld(SDL_Renderer *const renderer, const struct scene *const SCENE){
+        if(SDL_RenderClear(renderer) < 0){
+                fprintf(stderr, "*** Error: Unable to clear renderer: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        if(SCENE->layer){
+                if(drawLayer(renderer, SCENE)){
+                        fprintf(stderr, "*** Error: Unable to draw static layer\n");
+                        return 1;
+                }
+        }else if(drawStatic(SCENE)){
+                return 1;
+        }
+
+        if(SCENE->arena && SCENE->arena->count){
+                struct box box = { .w = SCENE->arena->w, .h = SCENE->arena->h };
+                for(unsigned i = 0; i < SCENE->arena->count; i++){
+                        box.x = SCENE->arena->x[i];
+                        box.y = SCENE->arena->y[i];
+                        if(drawSprite(SCENE, ATLAS_BALL, &box)){
+                                fprintf(stderr, "*** Error: Unable to draw ball %u\n", i);
+                                return 1;
+                        }
+                }
+        }else if(drawSprite(SCENE, ATLAS_BALL, &SCENE->world->ball.box)){
+                fprintf(stderr, "*** Error: Unable to draw ball\n");
+                return 1;
+        }
+
+        if(drawSprite(SCENE, ATLAS_PADDLE1, &SCENE->world->player1.avatar.box)){
+                fprintf(stderr, "*** Error: Unable to draw player 1\n");
+                return 1;
+        }
+
+        if(drawSprite(SCENE, ATLAS_PADDLE2, &SCENE->world->player2.avatar.box)){
+                fprintf(stderr, "*** Error: Unable to draw player 2\n");
+                return 1;
+        }
+
+        if(SCENE->profile && SCENE->profile->frame_count && drawHud(SCENE)){
+                fprintf(stderr, "*** Error: Unable to draw timing overlay\n");
+                return 1;
+        }
+
+        if(flushBatch(SCENE->batch)){
+                fprintf(stderr, "*** Error: Unable to submit sprite batch\n");
+                return 1;
+        }
+
+        return 0;
+}
+
+void freeLayer(struct layer *const layer){
+        if(layer->texture){
+                SDL_DestroyTexture(layer->texture);
+                layer->texture = NULL;
+        }
+        layer->valid = 0;
+}
+
+/* Fails when the renderer cannot draw into textures, in which case the
+ * static layer must be drawn with the rest of the frame */
+unsigned initLayer(struct layer *const layer, SDL_Renderer *const renderer){
+        *layer = (struct layer){ .texture = NULL };
+
+        if(!SDL_RenderTargetSupported(renderer)){
+                fprintf(stderr, "*** Error: Renderer does not support target textures\n");
+                return 1;
+        }
+
+        layer->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
+        if(!layer->texture){
+                fprintf(stderr, "*** Error: Unable to create static layer texture: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        /* the layer is opaque, so copying it need not blend */
+        if(SDL_SetTextureBlendMode(layer->texture, SDL_BLENDMODE_NONE)){
+                fprintf(stderr, "*** Error: Unable to set static layer blend mode: %s\n", SDL_GetError());
+                freeLayer(layer);
+                return 1;
+        }
+
+        return 0;
+}
+
+/* Bricks are plain rectangles, filled straight onto the renderer, so
+ * the background is flushed first to keep it beneath them; those that
+ * never break are grey and the rest orange */
+static unsigned drawBricks(const struct scene *const SCENE){
+        static const SDL_Color COLORS[] = { { 0x80, 0x80, 0x80, 0xFF }, { 0xE0, 0x80, 0x20, 0xFF } };
+        SDL_Renderer *const renderer = SCENE->batch->renderer;
+        if(flushBatch(SCENE->batch)){
+                return 1;
+        }
+
+        SDL_Rect rects[BRICK_RECTS];
+        for(unsigned pass = 0; pass < sizeof(COLORS)/sizeof(*COLORS); pass++){
+                if(SDL_SetRenderDrawColor(renderer, COLORS[pass].r, COLORS[pass].g, COLORS[pass].b, COLORS[pass].a) < 0){
+                        fprintf(stderr, "*** Error: Unable to set brick color: %s\n", SDL_GetError());
+                        return 1;
+                }
+
+                unsigned count = 0;
+                for(unsigned i = 0; i <= SCENE->field->count; i++){
+                        if(i < SCENE->field->count){
+                                const struct brick *const BRICK = &SCENE->field->bricks[i];
+                                if(!(SCENE->alive[i/64] >> i % 64 & 1) || (BRICK->strength != BRICK_SOLID) != pass){
+                                        continue;
+                                }
+                                rects[count++] = (SDL_Rect){ .x = BRICK->box.x, .y = BRICK->box.y, .w = BRICK->box.w, .h = BRICK->box.h };
+                        }
+                        if(count && (count == BRICK_RECTS || i == SCENE->field->count)){
+                                if(SDL_RenderFillRects(renderer, rects, count) < 0){
+                                        fprintf(stderr, "*** Error: Unable to fill bricks: %s\n", SDL_GetError());
+                                        return 1;
+                                }
+                                count = 0;
+                        }
+                }
+        }
+
+        if(SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255) < 0){
+                fprintf(stderr, "*** Error: Unable to restore draw color: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        return 0;
+}
+
+/* Timing overlay: for each phase of the main loop, the last frame, the
+ * median and 99th percentile so far, and the worst of recent frames */
+static unsigned drawHud(const struct scene *const SCENE){
+        static const int COLUMNS[] = { HUD_X, HUD_X + HUD_COLUMN, HUD_X + 2*HUD_COLUMN, HUD_X + 3*HUD_COLUMN, HUD_X + 4*HUD_COLUMN };
+        static const char *const HEADINGS[] = { "ms", "last", "p50", "p99", "peak" };
+        const int LINE_HEIGHT = SCENE->atlas->rects[ATLAS_GLYPH0].h;
+
+        for(unsigned i = 0; i < sizeof(HEADINGS)/sizeof(*HEADINGS); i++){
+                if(drawText(SCENE, HEADINGS[i], COLUMNS[i], HUD_Y)){
+                        return 1;
+                }
+        }
+
+        const struct profile_frame *const LAST = &SCENE->profile->frames[(SCENE->profile->frame_count - 1) % PROFILE_FRAMES];
+        struct profile_frame peaks;
+        recentMaxima(SCENE->profile, &peaks);
+        for(unsigned i = 0; i < PROFILE_PHASES; i++){
+                const int Y = HUD_Y + (i + 1)*LINE_HEIGHT;
+                const double VALUES[] = { LAST->phases[i]/1e6, histogramPercentile(&SCENE->profile->histograms[i], 50)/1e6, histogramPercentile(&SCENE->profile->histograms[i], 99)/1e6, peaks.phases[i]/1e6 };
+
+                if(drawText(SCENE, PROFILE_PHASE_NAMES[i], COLUMNS[0], Y)){
+                        return 1;
+                }
+                for(unsigned j = 0; j < sizeof(VALUES)/sizeof(*VALUES); j++){
+                        char text[16];
+                        snprintf(text, sizeof(text), "%.2f", VALUES[j]);
+                        if(drawText(SCENE, text, COLUMNS[j + 1], Y)){
+                                return 1;
+                        }
+                }
+        }
+
+        return 0;
+}
+
+/* Must be called with the batch empty, as the batch is flushed into the
+ * layer's texture while it is the render target */
+static unsigned drawLayer(SDL_Renderer *const renderer, const struct scene *const SCENE){
+        struct layer *const layer = SCENE->layer;
+        const unsigned SCORE1 = SCENE->world->player1.score;
+        const unsigned SCORE2 = SCENE->world->player2.score;
+        const unsigned long FIELD_VERSION = SCENE->field ? SCENE->field_version : 0;
+
+        if(!layer->valid || layer->score1 != SCORE1 || layer->score2 != SCORE2 || layer->field_version != FIELD_VERSION){
+                if(SDL_SetRenderTarget(renderer, layer->texture)){
+                        fprintf(stderr, "*** Error: Unable to render to static layer: %s\n", SDL_GetError());
+                        return 1;
+                }
+                const unsigned FAILED = SDL_RenderClear(renderer) < 0 || drawStatic(SCENE) || flushBatch(SCENE->batch);
+                if(SDL_SetRenderTarget(renderer, NULL)){
+                        fprintf(stderr, "*** Error: Unable to restore render target: %s\n", SDL_GetError());
+                        return 1;
+                }
+                if(FAILED){
+                        fprintf(stderr, "*** Error: Unable to redraw static layer\n");
+                        return 1;
+                }
+                layer->score1 = SCORE1;
+                layer->score2 = SCORE2;
+                layer->field_version = FIELD_VERSION;
+                layer->valid = 1;
+        }
+
+        if(SDL_RenderCopy(renderer, layer->texture, NULL, NULL)){
+                fprintf(stderr, "*** Error: Unable to copy static layer: %s\n", SDL_GetError());
+                return 1;
+        }
+
+        return 0;
+}
+
+static unsigned drawScore(const struct scene *const SCENE, const unsigned SCORE, const int X){
+        char score_str[16];
+        snprintf(score_str, sizeof(score_str), "%u", SCORE);
+
+        SDL_Rect dest = { .x = X, .y = 0 };
+        for(const char *digit = score_str; *digit; digit++){
+                const SDL_Rect *const SRC = &SCENE->atlas->rects[ATLAS_DIGIT0 + (*digit - '0')];
+                dest.w = SRC->w;
+                dest.h = SRC->h;
+                if(addQuad(SCENE->batch, SRC, &dest)){
+                        return 1;
+                }
+                dest.x += SRC->w;
+        }
+
+        return 0;
+}
+
+static unsigned drawSprite(const struct scene *const SCENE, const enum atlas_entry ENTRY, const struct box *const box){
+        const SDL_Rect DEST = { .x = box->x, .y = box->y, .w = box->w, .h = box->h };
+
+        return addQuad(SCENE->batch, &SCENE->atlas->rects[ENTRY], &DEST);
+}
+
+/* The background, bricks and scores, drawn beneath everything that
+ * moves */
+static unsigned drawStatic(const struct scene *const SCENE){
+        const struct box BACKGROUND = { .x = 0, .y = 0, .w = SCENE->atlas->rects[ATLAS_BACKGROUND].w, .h = SCENE->atlas->rects[ATLAS_BACKGROUND].h };
+        if(drawSprite(SCENE, ATLAS_BACKGROUND, &BACKGROUND)){
+                fprintf(stderr, "*** Error: Unable to draw background\n");
+                return 1;
+        }
+
+        if(SCENE->field && drawBricks(SCENE)){
+                fprintf(stderr, "*** Error: Unable to draw bricks\n");
+                return 1;
+        }
+
+        if(drawScore(SCENE, SCENE->world->player1.score, SCORE1_X)){
+                fprintf(stderr, "*** Error: Unable to draw player 1 score\n");
+                return 1;
+        }
+
+        if(drawScore(SCENE, SCENE->world->player2.score, SCORE2_X)){
+                fprintf(stderr, "*** Error: Unable to draw player 2 score\n");
+                return 1;
+        }
+
+        return 0;
+}
+
+static unsigned drawText(const struct scene *const SCENE, const char *const TEXT, const int X, const int Y){
+        SDL_Rect dest = { .x = X, .y = Y };
+        for(const char *c = TEXT; *c; c++){
+                const unsigned GLYPH = (*c >= ATLAS_GLYPH_FIRST && *c < ATLAS_GLYPH_FIRST + ATLAS_GLYPHS) ? *c - ATLAS_GLYPH_FIRST : '?' - ATLAS_GLYPH_FIRST;
+                const SDL_Rect *const SRC = &SCENE->atlas->rects[ATLAS_GLYPH0 + GLYPH];
+                dest.w = SRC->w;
+                dest.h = SRC->h;
+                if(addQuad(SCENE->batch, SRC, &dest)){
+                        return 1;
+                }
+                dest.x += SRC->w;
+        }
+
+        return 0;
+}
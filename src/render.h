@@ -0,0 +1,79 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "SDL.h"
+
+#include "arena.h"
+#include "atlas.h"
+#include "batch.h"
+#include "field.h"
+#include "profile.h"
+#include "world.h"
+
+#define SCORE1_X (WIDTH/4)
+#define SCORE2_X (WIDTH - WIDTH/4)
+
+/* The background, bricks and scores, which only change when a point is
+ * scored or a brick broken, kept in a target texture so that each frame
+ * copies them in one go instead of blending every sprite again. The
+ * texture is redrawn when the scores or field version differ from those
+ * it shows or it is no longer valid. */
+struct layer{
+        SDL_Texture *texture;
+        unsigned score1;
+        unsigned score2;
+        unsigned long field_version;
+        unsigned valid;
+};
+
+/* Everything that goes into a frame. The arena's balls are drawn in
+ * place of the world's ball whenever there are any, the timing overlay
+ * is drawn whenever a profile is given, and the static layer is drawn
+ * from its cache whenever one is given. The field's bricks are drawn
+ * whenever a field is given, those with their bit set in ALIVE, which
+ * is as of FIELD_VERSION. */
+struct scene{
+        const struct atlas *atlas;
+        struct batch *batch;
+        const struct world *world;
+        const struct arena *arena;
+        const struct profile *profile;
+        struct layer *layer;
+        const struct field *field;
+        const uint64_t *alive;
+        unsigned long field_version;
+};
+
+unsigned drawPlaceholder(SDL_Renderer *const renderer, const struct world *const WORLD);
+unsigned drawWorld(SDL_Renderer *const renderer, const struct scene *const SCENE);
+void freeLayer(struct layer *const layer);
+unsigned initLayer(struct layer *const layer, SDL_Renderer *const renderer);
+
+#endif
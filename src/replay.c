@@ -0,0 +1,359 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+#include "world.h"
+
+#define MAX_EVENT_SIZE 21
+
+static unsigned appendEvent(struct replay *const replay, const enum replay_event KIND, const int VALUE);
+static void applyEvent(struct playback *const playback);
+static void nextEventTick(struct playback *const playback);
+static unsigned readVarint(const unsigned char *const data, const size_t SIZE, size_t *const offset, uint64_t *const value);
+static void replayWorld(const struct replay_header *const HEADER, struct world *const world);
+static unsigned validateEvents(const struct replay *const replay);
+static size_t writeVarint(unsigned char *const data, uint64_t value);
+
+void freePlayback(struct playback *const playback){
+        free(playback->snapshots);
+}
+
+void freeReplay(struct replay *const replay){
+        free(replay->events);
+}
+
+unsigned initPlayback(struct playback *const playback, const struct replay *const replay){
+        const uint64_t SNAPSHOTS = replay->header.ticks/REPLAY_SNAPSHOT_INTERVAL + 1;
+
+        playback->snapshots = malloc(sizeof(*playback->snapshots)*SNAPSHOTS);
+        if(!playback->snapshots){
+                fprintf(stderr, "*** Error: Unable to allocate %llu replay snapshots\n", (unsigned long long)SNAPSHOTS);
+                return 1;
+        }
+        playback->snapshot_count = 0;
+
+        playback->replay = replay;
+        replayWorld(&replay->header, &playback->world);
+        playback->tick = 0;
+        playback->offset = 0;
+        playback->next_tick = 0;
+        nextEventTick(playback);
+
+        return 0;
+}
+
+unsigned loadReplay(const char *const PATH, struct replay *const replay){
+        FILE *const file = fopen(PATH, "rb");
+        if(!file){
+                fprintf(stderr, "*** Error: Unable to open replay \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        memset(replay, 0, sizeof(*replay));
+        struct replay_header *const HEADER = &replay->header;
+        if(fread(HEADER, sizeof(*HEADER), 1, file) != 1){
+                fprintf(stderr, "*** Error: Replay \"%s\" is truncated\n", PATH);
+                goto err_read_header;
+        }
+        if(memcmp(HEADER->magic, REPLAY_MAGIC, sizeof(HEADER->magic)) || HEADER->version != REPLAY_VERSION){
+                fprintf(stderr, "*** Error: \"%s\" is not a compatible replay\n", PATH);
+                goto err_invalid_header;
+        }
+        if(HEADER->ball_w <= 0 || HEADER->ball_w > WIDTH || HEADER->ball_h <= 0 || HEADER->ball_h >= HEIGHT
+           || HEADER->paddle1_w <= 0 || HEADER->paddle1_w > WIDTH || HEADER->paddle1_h <= 0 || HEADER->paddle1_h > HEIGHT
+           || HEADER->paddle2_w <= 0 || HEADER->paddle2_w > WIDTH || HEADER->paddle2_h <= 0 || HEADER->paddle2_h > HEIGHT){
+                fprintf(stderr, "*** Error: Replay \"%s\" has invalid sprite sizes\n", PATH);
+                goto err_invalid_header;
+        }
+
+        replay->events = malloc(HEADER->size ? HEADER->size : 1);
+        if(!replay->events){
+                fprintf(stderr, "*** Error: Unable to allocate %u bytes of replay events\n", HEADER->size);
+                goto err_alloc_events;
+        }
+        replay->capacity = HEADER->size;
+        if(fread(replay->events, 1, HEADER->size, file) != HEADER->size){
+                fprintf(stderr, "*** Error: Replay \"%s\" is truncated\n", PATH);
+                goto err_read_events;
+        }
+        if(validateEvents(replay)){
+                fprintf(stderr, "*** Error: Replay \"%s\" has corrupt events\n", PATH);
+                goto err_validate_events;
+        }
+
+        fclose(file);
+
+        return 0;
+
+err_validate_events:
+err_read_events:
+        free(replay->events);
+err_alloc_events:
+err_invalid_header:
+err_read_header:
+        fclose(file);
+        return 1;
+}
+
+/* A new game is started from handleEvents(), between ticks, so it is
+ * logged with the next tick */
+void markReset(struct replay *const replay){
+        replay->reset = 1;
+}
+
+/* Called before each tick is stepped; only changes of input are logged */
+unsigned recordTick(struct replay *const replay, const struct world *const world){
+        if(replay->reset){
+                if(appendEvent(replay, REPLAY_RESET, 0)){
+                        return 1;
+                }
+                replay->reset = 0;
+        }
+        if(world->player1.avatar.y_vel != replay->y_vel1){
+                if(appendEvent(replay, REPLAY_PADDLE1, world->player1.avatar.y_vel)){
+                        return 1;
+                }
+                replay->y_vel1 = world->player1.avatar.y_vel;
+        }
+        if(world->player2.avatar.y_vel != replay->y_vel2){
+                if(appendEvent(replay, REPLAY_PADDLE2, world->player2.avatar.y_vel)){
+                        return 1;
+                }
+                replay->y_vel2 = world->player2.avatar.y_vel;
+        }
+
+        replay->header.ticks++;
+
+        return 0;
+}
+
+unsigned saveReplay(struct replay *const replay, const char *const PATH, const struct world *const world){
+        replay->header.hash = hashWorld(world);
+
+        FILE *const file = fopen(PATH, "wb");
+        if(!file){
+                fprintf(stderr, "*** Error: Unable to create replay \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        if(fwrite(&replay->header, sizeof(replay->header), 1, file) != 1 || fwrite(replay->events, 1, replay->header.size, file) != replay->header.size){
+                fprintf(stderr, "*** Error: Unable to write replay \"%s\": %s\n", PATH, strerror(errno));
+                goto err_write;
+        }
+
+        if(fclose(file)){
+                fprintf(stderr, "*** Error: Unable to write replay \"%s\": %s\n", PATH, strerror(errno));
+                return 1;
+        }
+
+        return 0;
+
+err_write:
+        fclose(file);
+        return 1;
+}
+
+/* Rewinds to the closest snapshot at or before TICK, if TICK has already
+ * been passed, and then plays forward to it */
+void seekPlayback(struct playback *const playback, const uint64_t TICK){
+        const uint64_t TARGET = (TICK < playback->replay->header.ticks) ? TICK : playback->replay->header.ticks;
+
+        if(TARGET < playback->tick){
+                const uint64_t INDEX = TARGET/REPLAY_SNAPSHOT_INTERVAL;
+                const struct replay_snapshot *const SNAPSHOT = &playback->snapshots[INDEX];
+                playback->world = SNAPSHOT->world;
+                playback->offset = SNAPSHOT->offset;
+                playback->next_tick = SNAPSHOT->next_tick;
+                playback->tick = INDEX*REPLAY_SNAPSHOT_INTERVAL;
+        }
+
+        while(playback->tick < TARGET){
+                stepPlayback(playback);
+        }
+}
+
+void startRecording(struct replay *const replay, const struct world *const world, const uint64_t SEED){
+        memset(replay, 0, sizeof(*replay));
+        memcpy(replay->header.magic, REPLAY_MAGIC, sizeof(replay->header.magic));
+        replay->header.version = REPLAY_VERSION;
+        replay->header.seed = SEED;
+        replay->header.ball_w = world->ball.box.w;
+        replay->header.ball_h = world->ball.box.h;
+        replay->header.paddle1_w = world->player1.avatar.box.w;
+        replay->header.paddle1_h = world->player1.avatar.box.h;
+        replay->header.paddle2_w = world->player2.avatar.box.w;
+        replay->header.paddle2_h = world->player2.avatar.box.h;
+        replay->y_vel1 = world->player1.avatar.y_vel;
+        replay->y_vel2 = world->player2.avatar.y_vel;
+}
+
+void stepPlayback(struct playback *const playback){
+        if(playback->tick == playback->snapshot_count*REPLAY_SNAPSHOT_INTERVAL){
+                struct replay_snapshot *const snapshot = &playback->snapshots[playback->snapshot_count++];
+                snapshot->world = playback->world;
+                snapshot->offset = playback->offset;
+                snapshot->next_tick = playback->next_tick;
+        }
+
+        while(playback->next_tick == playback->tick){
+                applyEvent(playback);
+        }
+
+        stepWorld(&playback->world);
+        playback->tick++;
+}
+
+static unsigned appendEvent(struct replay *const replay, const enum replay_event KIND, const int VALUE){
+        if(replay->header.size + MAX_EVENT_SIZE > replay->capacity){
+                const size_t CAPACITY = replay->capacity ? 2*replay->capacity : 4096;
+                if(CAPACITY > UINT32_MAX){
+                        fprintf(stderr, "*** Error: Replay is too long\n");
+                        return 1;
+                }
+                unsigned char *const events = realloc(replay->events, CAPACITY);
+                if(!events){
+                        fprintf(stderr, "*** Error: Unable to grow replay to %zu bytes\n", CAPACITY);
+                        return 1;
+                }
+                replay->events = events;
+                replay->capacity = CAPACITY;
+        }
+
+        unsigned char *const data = replay->events;
+        size_t size = replay->header.size;
+        size += writeVarint(data + size, replay->header.ticks - replay->last_tick);
+        data[size++] = KIND;
+        if(KIND != REPLAY_RESET){
+                size += writeVarint(data + size, ((uint64_t)VALUE << 1) ^ (uint64_t)-(int64_t)(VALUE < 0));
+        }
+        replay->header.size = size;
+        replay->last_tick = replay->header.ticks;
+
+        return 0;
+}
+
+/* Events were checked by validateEvents() when the replay was loaded */
+static void applyEvent(struct playback *const playback){
+        const unsigned char *const DATA = playback->replay->events;
+        const size_t SIZE = playback->replay->header.size;
+        const enum replay_event KIND = DATA[playback->offset++];
+
+        uint64_t value = 0;
+        if(KIND != REPLAY_RESET){
+                readVarint(DATA, SIZE, &playback->offset, &value);
+        }
+        const int Y_VEL = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+
+        switch(KIND){
+                case REPLAY_PADDLE1:
+                        playback->world.player1.avatar.y_vel = Y_VEL;
+                        break;
+                case REPLAY_PADDLE2:
+                        playback->world.player2.avatar.y_vel = Y_VEL;
+                        break;
+                default:
+                        resetWorld(&playback->world);
+                        break;
+        }
+
+        nextEventTick(playback);
+}
+
+static void nextEventTick(struct playback *const playback){
+        uint64_t delta;
+        if(readVarint(playback->replay->events, playback->replay->header.size, &playback->offset, &delta)){
+                playback->next_tick = UINT64_MAX;
+        }else{
+                playback->next_tick += delta;
+        }
+}
+
+static unsigned readVarint(const unsigned char *const data, const size_t SIZE, size_t *const offset, uint64_t *const value){
+        *value = 0;
+        for(unsigned shift = 0; shift < 64 && *offset < SIZE; shift += 7){
+                const unsigned char BYTE = data[(*offset)++];
+                *value |= (uint64_t)(BYTE & 0x7F) << shift;
+                if(!(BYTE & 0x80)){
+                        return 0;
+                }
+        }
+
+        return 1;
+}
+
+/* Rebuilds the world exactly as it was when the recording started */
+static void replayWorld(const struct replay_header *const HEADER, struct world *const world){
+        const struct world INITIAL = WORLD_INITIALIZER;
+        *world = INITIAL;
+
+        world->ball.box.w = HEADER->ball_w;
+        world->ball.box.h = HEADER->ball_h;
+        world->player1.avatar.box.w = HEADER->paddle1_w;
+        world->player1.avatar.box.h = HEADER->paddle1_h;
+        world->player2.avatar.box.w = HEADER->paddle2_w;
+        world->player2.avatar.box.h = HEADER->paddle2_h;
+        initWorld(world, HEADER->seed);
+}
+
+static unsigned validateEvents(const struct replay *const replay){
+        const unsigned char *const DATA = replay->events;
+        const size_t SIZE = replay->header.size;
+
+        size_t offset = 0;
+        uint64_t tick = 0;
+        while(offset < SIZE){
+                uint64_t delta;
+                if(readVarint(DATA, SIZE, &offset, &delta) || delta >= replay->header.ticks - tick || offset >= SIZE){
+                        return 1;
+                }
+                tick += delta;
+
+                const unsigned KIND = DATA[offset++];
+                uint64_t value;
+                if(KIND >= REPLAY_EVENTS || (KIND != REPLAY_RESET && (readVarint(DATA, SIZE, &offset, &value) || value > 2*(uint64_t)HEIGHT))){
+                        return 1;
+                }
+        }
+
+        return 0;
+}
+
+static size_t writeVarint(unsigned char *const data, uint64_t value){
+        size_t size = 0;
+        while(value >= 0x80){
+                data[size++] = (value & 0x7F) | 0x80;
+                value >>= 7;
+        }
+        data[size++] = value;
+
+        return size;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "world.h"
+
+#define REPLAY_MAGIC "FBPR"
+#define REPLAY_VERSION 2
+#define REPLAY_SNAPSHOT_INTERVAL 256
+
+/* A replay is this header followed by the input events. Each event is a
+ * varint count of ticks since the previous event, a kind byte and, for
+ * paddle events, the new y_vel as a zigzag varint. Events at tick T are
+ * applied before stepping tick T. Fields are in host byte order. */
+enum replay_event{
+        REPLAY_PADDLE1,
+        REPLAY_PADDLE2,
+        REPLAY_RESET,
+        REPLAY_EVENTS
+};
+
+struct replay_header{
+        char magic[4];
+        uint32_t version;
+        uint64_t seed;
+        uint64_t ticks;
+        uint64_t hash;
+        int32_t ball_w;
+        int32_t ball_h;
+        int32_t paddle1_w;
+        int32_t paddle1_h;
+        int32_t paddle2_w;
+        int32_t paddle2_h;
+        uint32_t size;
+        uint32_t reserved;
+};
+
+struct replay{
+        struct replay_header header;
+        unsigned char *events;
+        size_t capacity;
+        uint64_t last_tick;
+        int y_vel1;
+        int y_vel2;
+        unsigned reset;
+};
+
+/* The state of a playback before applying the events of a given tick */
+struct replay_snapshot{
+        struct world world;
+        size_t offset;
+        uint64_t next_tick;
+};
+
+struct playback{
+        const struct replay *replay;
+        struct world world;
+        uint64_t tick;
+        size_t offset;
+        uint64_t next_tick;
+        struct replay_snapshot *snapshots;
+        uint64_t snapshot_count;
+};
+
+void freePlayback(struct playback *const playback);
+void freeReplay(struct replay *const replay);
+unsigned initPlayback(struct playback *const playback, const struct replay *const replay);
+unsigned loadReplay(const char *const PATH, struct replay *const replay);
+void markReset(struct replay *const replay);
+unsigned recordTick(struct replay *const replay, const struct world *const world);
+unsigned saveReplay(struct replay *const replay, const char *const PATH, const struct world *const world);
+void seekPlayback(struct playback *const playback, const uint64_t TICK);
+void startRecording(struct replay *const replay, const struct world *const world, const uint64_t SEED);
+void stepPlayback(struct playback *const playback);
+
+#endif
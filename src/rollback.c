@@ -0,0 +1,209 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+
+#include "rollback.h"
+#include "world.h"
+
+#define SLOT(TICK) ((TICK) % ROLLBACK_FRAMES)
+#define RECEIVED_SLOT(TICK) ((TICK) % (2*ROLLBACK_FRAMES))
+
+static uint32_t get32(const unsigned char *const DATA);
+static uint64_t get64(const unsigned char *const DATA);
+static void put32(unsigned char *const data, const uint32_t VALUE);
+static void put64(unsigned char *const data, const uint64_t VALUE);
+static void receiveInput(struct rollback *const rollback, const uint64_t TICK, const int8_t INPUT);
+static int8_t remoteInput(const struct rollback *const rollback, const uint64_t TICK);
+static void simulateTick(struct rollback *const rollback, const uint64_t TICK);
+
+/* The local input is applied to the very next tick; the remote one is
+ * predicted to be whatever the peer last sent */
+void advanceRollback(struct rollback *const rollback, const int INPUT){
+        settleRollback(rollback);
+
+        rollback->local[SLOT(rollback->tick)] = INPUT;
+        simulateTick(rollback, rollback->tick);
+        rollback->tick++;
+}
+
+void initRollback(struct rollback *const rollback, const struct world *const world, const unsigned PLAYER){
+        memset(rollback, 0, sizeof(*rollback));
+        rollback->world = *world;
+        rollback->player = PLAYER;
+        rollback->check = UINT64_MAX;
+}
+
+unsigned readHello(const unsigned char *const DATA, const size_t SIZE, uint64_t *const seed, uint64_t *const hash){
+        if(SIZE != 19 || DATA[0] != (ROLLBACK_MAGIC & 0xFF) || DATA[1] != ROLLBACK_MAGIC >> 8 || DATA[2] != ROLLBACK_HELLO){
+                return 1;
+        }
+
+        *seed = get64(DATA + 3);
+        *hash = get64(DATA + 11);
+
+        return 0;
+}
+
+unsigned readInputs(struct rollback *const rollback, const unsigned char *const DATA, const size_t SIZE){
+        if(SIZE < 12 || DATA[0] != (ROLLBACK_MAGIC & 0xFF) || DATA[1] != ROLLBACK_MAGIC >> 8 || DATA[2] != ROLLBACK_INPUTS || SIZE != 12u + DATA[3]){
+                return 1;
+        }
+
+        const uint32_t ACK = get32(DATA + 4);
+        if(ACK > rollback->acked && ACK <= rollback->tick){
+                rollback->acked = ACK;
+        }
+
+        const uint32_t START = get32(DATA + 8);
+        for(unsigned i = 0; i < DATA[3]; i++){
+                receiveInput(rollback, (uint64_t)START + i, DATA[12 + i]);
+        }
+
+        return 0;
+}
+
+/* Past states must stay in the ring until every input that could still
+ * change them has been confirmed, and unacknowledged local inputs must
+ * remain available to be sent again */
+unsigned rollbackStalled(const struct rollback *const rollback){
+        const uint64_t OLDEST = (rollback->confirmed < rollback->acked) ? rollback->confirmed : rollback->acked;
+
+        return rollback->tick - OLDEST >= ROLLBACK_FRAMES;
+}
+
+/* Re-simulates from the earliest tick whose remote input turned out to
+ * differ from the one used, after late or corrected inputs arrived */
+void settleRollback(struct rollback *const rollback){
+        uint64_t tick = rollback->check;
+        rollback->check = UINT64_MAX;
+        while(tick < rollback->tick && remoteInput(rollback, tick) == rollback->remote[SLOT(tick)]){
+                tick++;
+        }
+        if(tick >= rollback->tick){
+                return;
+        }
+
+        const unsigned DEPTH = rollback->tick - tick;
+        rollback->rollbacks++;
+        rollback->resimulated += DEPTH;
+        if(DEPTH > rollback->max_depth){
+                rollback->max_depth = DEPTH;
+        }
+
+        rollback->world = rollback->states[SLOT(tick)];
+        for(; tick < rollback->tick; tick++){
+                simulateTick(rollback, tick);
+        }
+}
+
+size_t writeHello(unsigned char *const data, const uint64_t SEED, const uint64_t HASH){
+        data[0] = ROLLBACK_MAGIC & 0xFF;
+        data[1] = ROLLBACK_MAGIC >> 8;
+        data[2] = ROLLBACK_HELLO;
+        put64(data + 3, SEED);
+        put64(data + 11, HASH);
+
+        return 19;
+}
+
+/* Every local input the peer has not acknowledged is sent again, so a
+ * lost packet costs nothing but a deeper rollback on the other side */
+size_t writeInputs(const struct rollback *const rollback, unsigned char *const data){
+        const unsigned COUNT = rollback->tick - rollback->acked;
+
+        data[0] = ROLLBACK_MAGIC & 0xFF;
+        data[1] = ROLLBACK_MAGIC >> 8;
+        data[2] = ROLLBACK_INPUTS;
+        data[3] = COUNT;
+        put32(data + 4, rollback->confirmed);
+        put32(data + 8, rollback->acked);
+        for(unsigned i = 0; i < COUNT; i++){
+                data[12 + i] = rollback->local[SLOT(rollback->acked + i)];
+        }
+
+        return 12 + COUNT;
+}
+
+static uint32_t get32(const unsigned char *const DATA){
+        return DATA[0] | (uint32_t)DATA[1] << 8 | (uint32_t)DATA[2] << 16 | (uint32_t)DATA[3] << 24;
+}
+
+static uint64_t get64(const unsigned char *const DATA){
+        return get32(DATA) | (uint64_t)get32(DATA + 4) << 32;
+}
+
+static void put32(unsigned char *const data, const uint32_t VALUE){
+        data[0] = VALUE;
+        data[1] = VALUE >> 8;
+        data[2] = VALUE >> 16;
+        data[3] = VALUE >> 24;
+}
+
+static void put64(unsigned char *const data, const uint64_t VALUE){
+        put32(data, VALUE);
+        put32(data + 4, VALUE >> 32);
+}
+
+/* Inputs are kept from the oldest tick that may still be re-simulated,
+ * which is never more than ROLLBACK_FRAMES behind, up to as many ticks
+ * ahead for when the peer is running ahead */
+static void receiveInput(struct rollback *const rollback, const uint64_t TICK, const int8_t INPUT){
+        if(TICK < rollback->confirmed || TICK >= rollback->tick + ROLLBACK_FRAMES){
+                return;
+        }
+
+        rollback->received[RECEIVED_SLOT(TICK)] = INPUT;
+        rollback->received_tick[RECEIVED_SLOT(TICK)] = TICK + 1;
+        while(rollback->received_tick[RECEIVED_SLOT(rollback->confirmed)] == rollback->confirmed + 1){
+                rollback->prediction = rollback->received[RECEIVED_SLOT(rollback->confirmed)];
+                rollback->confirmed++;
+        }
+
+        if(TICK < rollback->check){
+                rollback->check = TICK;
+        }
+}
+
+static int8_t remoteInput(const struct rollback *const rollback, const uint64_t TICK){
+        if(rollback->received_tick[RECEIVED_SLOT(TICK)] == TICK + 1){
+                return rollback->received[RECEIVED_SLOT(TICK)];
+        }
+
+        return rollback->prediction;
+}
+
+static void simulateTick(struct rollback *const rollback, const uint64_t TICK){
+        struct world *const world = &rollback->world;
+        const int8_t REMOTE = remoteInput(rollback, TICK);
+
+        rollback->states[SLOT(TICK)] = *world;
+        rollback->remote[SLOT(TICK)] = REMOTE;
+        world->player1.avatar.y_vel = rollback->player ? REMOTE : rollback->local[SLOT(TICK)];
+        world->player2.avatar.y_vel = rollback->player ? rollback->local[SLOT(TICK)] : REMOTE;
+        stepWorld(world);
+}
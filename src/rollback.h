@@ -0,0 +1,80 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "world.h"
+
+/* Ticks of history kept; the local game stalls rather than run further
+ * ahead of the last input confirmed by the peer */
+#define ROLLBACK_FRAMES 64
+
+#define ROLLBACK_MAGIC 0x4642u
+#define ROLLBACK_PACKET_SIZE (12 + ROLLBACK_FRAMES)
+
+/* Packets start with the magic and a type byte. A hello carries the
+ * match seed and a hash of the starting world. An inputs packet carries
+ * the first remote tick still missing (the ack), then the sender's
+ * paddle y_vel for a run of ticks starting at the given tick. Integers
+ * are little-endian. */
+enum rollback_packet{
+        ROLLBACK_HELLO,
+        ROLLBACK_INPUTS
+};
+
+struct rollback{
+        struct world world;
+        struct world states[ROLLBACK_FRAMES];
+        int8_t local[ROLLBACK_FRAMES];
+        int8_t remote[ROLLBACK_FRAMES];
+        int8_t received[2*ROLLBACK_FRAMES];
+        uint64_t received_tick[2*ROLLBACK_FRAMES];
+        unsigned player;
+        uint64_t tick;
+        uint64_t confirmed;
+        uint64_t acked;
+        uint64_t check;
+        int8_t prediction;
+        unsigned long rollbacks;
+        unsigned long resimulated;
+        unsigned max_depth;
+};
+
+void advanceRollback(struct rollback *const rollback, const int INPUT);
+void initRollback(struct rollback *const rollback, const struct world *const world, const unsigned PLAYER);
+unsigned readHello(const unsigned char *const DATA, const size_t SIZE, uint64_t *const seed, uint64_t *const hash);
+unsigned readInputs(struct rollback *const rollback, const unsigned char *const DATA, const size_t SIZE);
+unsigned rollbackStalled(const struct rollback *const rollback);
+void settleRollback(struct rollback *const rollback);
+size_t writeHello(unsigned char *const data, const uint64_t SEED, const uint64_t HASH);
+size_t writeInputs(const struct rollback *const rollback, unsigned char *const data);
+
+#endif
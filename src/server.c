@@ -0,0 +1,733 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "histogram.h"
+#include "match.h"
+#include "pool.h"
+#include "protocol.h"
+#include "world.h"
+
+#define TICK_RATE 30
+#define MATCH_POINTS 11
+#define SERVER_PORT 7777
+#define SERVER_SLOTS 4096
+#define SERVER_BATCH 64
+#define SERVER_SOCKET_BUFFER (4 << 20)
+#define NO_SLOT UINT32_MAX
+
+/* Ticks without word from a player before their match is dropped, and
+ * ticks a finished match goes on sending its final state, so that it
+ * gets through however many packets are lost */
+#define SERVER_TIMEOUT (10*TICK_RATE)
+#define SERVER_LINGER TICK_RATE
+
+enum worker_event{
+        EVENT_SOCKET,
+        EVENT_TIMER,
+        EVENT_STOP
+};
+
+struct client{
+        struct sockaddr_storage address;
+        socklen_t length;
+        unsigned joined;
+        uint32_t sequence;
+        uint32_t ack;
+        uint32_t heard;
+};
+
+/* A match, in a slot allocated when the server starts. HISTORY holds the
+ * states of the last PROTOCOL_HISTORY ticks, as bases for deltas, and
+ * FINISHED the tick of the worker at which the match ended, if it has. */
+struct slot{
+        struct world world;
+        uint32_t key;
+        uint32_t tick;
+        uint32_t finished;
+        unsigned position;
+        struct client clients[2];
+        struct protocol_state history[PROTOCOL_HISTORY];
+};
+
+/* Outgoing datagrams, sent with one sendmmsg() call per batch */
+struct outbox{
+        unsigned count;
+        struct mmsghdr messages[SERVER_BATCH];
+        struct iovec iovecs[SERVER_BATCH];
+        unsigned char packets[SERVER_BATCH][PROTOCOL_MAX_PACKET];
+};
+
+/* Each worker has a socket of its own, on the server's port plus its
+ * id, and hosts every match whose key it is given modulo the number of
+ * workers, so workers share nothing and take no locks. Its matches are
+ * found through an open-addressed TABLE of slot indices by key, and
+ * ticked in a batch from the dense ACTIVE list. */
+struct worker{
+        pthread_t thread;
+        struct server *server;
+        unsigned id;
+        int fd;
+        int epoll;
+        int timer;
+        uint32_t now;
+        struct slot *slots;
+        uint32_t *free;
+        unsigned free_count;
+        uint32_t *active;
+        unsigned active_count;
+        uint32_t *table;
+        uint32_t table_mask;
+        struct outbox outbox;
+        struct mmsghdr in_messages[SERVER_BATCH];
+        struct iovec in_iovecs[SERVER_BATCH];
+        struct sockaddr_storage in_addresses[SERVER_BATCH];
+        unsigned char in_packets[SERVER_BATCH][PROTOCOL_MAX_PACKET];
+        struct histogram ticks;
+        unsigned long overruns;
+        unsigned long matches;
+        unsigned peak;
+        unsigned long received;
+        unsigned long sent;
+        unsigned long dropped;
+        unsigned long rejected;
+} __attribute__((aligned(64)));
+
+struct server{
+        struct worker *workers;
+        unsigned count;
+        unsigned slots;
+        unsigned port;
+        uint64_t seed;
+        int stop;
+};
+
+struct options{
+        unsigned port;
+        unsigned workers;
+        unsigned slots;
+        unsigned long seed;
+};
+
+static void closeSlot(struct worker *const worker, const uint32_t INDEX);
+static void closeWorker(struct worker *const worker);
+static uint32_t findSlot(const struct worker *const WORKER, const uint32_t KEY);
+static void flushOutbox(struct worker *const worker);
+static void handlePacket(struct worker *const worker, const unsigned char *const DATA, const size_t SIZE, const struct sockaddr_storage *const ADDRESS, const socklen_t LENGTH);
+static uint64_t nanoseconds(void);
+static uint32_t openSlot(struct worker *const worker, const uint32_t KEY);
+static unsigned openWorker(struct worker *const worker, struct server *const server, const unsigned ID);
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options);
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number);
+static void printReport(const struct server *const SERVER);
+static unsigned char *queuePacket(struct worker *const worker, const struct sockaddr_storage *const ADDRESS, const socklen_t LENGTH);
+static void receivePackets(struct worker *const worker);
+static void *runWorker(void *const argument);
+static void sendState(struct worker *const worker, const struct slot *const SLOT, const unsigned PLAYER);
+static void stopWorkers(struct server *const server, const unsigned STARTED);
+static uint32_t tableIndex(const struct worker *const WORKER, const uint32_t KEY);
+static void tickWorker(struct worker *const worker);
+
+/* Hosts matches for clients over UDP until interrupted, then reports how
+ * long each worker's ticks took */
+int main(int argc, char *argv[]){
+        struct options options = { .port = SERVER_PORT, .workers = onlineProcessors(), .slots = SERVER_SLOTS, .seed = time(NULL) };
+        if(parseArgs(argc, argv, &options)){
+                fprintf(stderr, "Usage: %s [--port PORT] [--workers N] [--slots N] [--seed N]\n", argv[0]);
+                return 1;
+        }
+
+        /* Only the main thread takes the signals to stop, and the workers
+         * inherit the mask */
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+        struct server server = { .count = options.workers, .slots = options.slots, .port = options.port, .seed = options.seed };
+        server.stop = eventfd(0, EFD_NONBLOCK);
+        if(server.stop < 0){
+                fprintf(stderr, "*** Error: Unable to create stop event: %s\n", strerror(errno));
+                return 1;
+        }
+        if(posix_memalign((void **)&server.workers, 64, sizeof(*server.workers)*server.count)){
+                fprintf(stderr, "*** Error: Unable to allocate %u workers\n", server.count);
+                goto err_workers;
+        }
+
+        unsigned opened = 0;
+        while(opened < server.count){
+                if(openWorker(&server.workers[opened], &server, opened)){
+                        fprintf(stderr, "*** Error: Unable to set up worker %u\n", opened);
+                        goto err_openWorker;
+                }
+                opened++;
+        }
+
+        unsigned started = 0;
+        while(started < server.count){
+                if(pthread_create(&server.workers[started].thread, NULL, runWorker, &server.workers[started])){
+                        fprintf(stderr, "*** Error: Unable to start worker %u\n", started);
+                        goto err_pthread_create;
+                }
+                started++;
+        }
+        printf("Serving on ports %u-%u with %u workers of %u slots\n", server.port, server.port + server.count - 1, server.count, server.slots);
+        fflush(stdout);
+
+        int caught;
+        sigwait(&signals, &caught);
+        stopWorkers(&server, started);
+        printReport(&server);
+
+        for(unsigned i = 0; i < opened; i++){
+                closeWorker(&server.workers[i]);
+        }
+        free(server.workers);
+        close(server.stop);
+
+        return 0;
+
+err_pthread_create:
+        stopWorkers(&server, started);
+err_openWorker:
+        for(unsigned i = 0; i < opened; i++){
+                closeWorker(&server.workers[i]);
+        }
+        free(server.workers);
+err_workers:
+        close(server.stop);
+        return 1;
+}
+
+/* Takes the slot out of the table, shifting back any entries after it
+ * that would otherwise no longer be found, and out of the active list */
+static void closeSlot(struct worker *const worker, const uint32_t INDEX){
+        struct slot *const slot = &worker->slots[INDEX];
+
+        uint32_t hole = tableIndex(worker, slot->key);
+        while(worker->table[hole] != INDEX){
+                hole = (hole + 1) & worker->table_mask;
+        }
+        for(uint32_t next = (hole + 1) & worker->table_mask; worker->table[next] != NO_SLOT; next = (next + 1) & worker->table_mask){
+                const uint32_t HOME = tableIndex(worker, worker->slots[worker->table[next]].key);
+                if(((next - HOME) & worker->table_mask) >= ((next - hole) & worker->table_mask)){
+                        worker->table[hole] = worker->table[next];
+                        hole = next;
+                }
+        }
+        worker->table[hole] = NO_SLOT;
+
+        const uint32_t LAST = worker->active[--worker->active_count];
+        worker->active[slot->position] = LAST;
+        worker->slots[LAST].position = slot->position;
+        worker->free[worker->free_count++] = INDEX;
+}
+
+static void closeWorker(struct worker *const worker){
+        close(worker->timer);
+        close(worker->epoll);
+        close(worker->fd);
+        free(worker->slots);
+        free(worker->free);
+        free(worker->active);
+        free(worker->table);
+}
+
+static uint32_t findSlot(const struct worker *const WORKER, const uint32_t KEY){
+        for(uint32_t i = tableIndex(WORKER, KEY); WORKER->table[i] != NO_SLOT; i = (i + 1) & WORKER->table_mask){
+                if(WORKER->slots[WORKER->table[i]].key == KEY){
+                        return WORKER->table[i];
+                }
+        }
+
+        return NO_SLOT;
+}
+
+/* Datagrams the socket buffer has no room for are dropped, as they
+ * would be anywhere else along the way */
+static void flushOutbox(struct worker *const worker){
+        struct outbox *const outbox = &worker->outbox;
+        unsigned sent = 0;
+        while(sent < outbox->count){
+                const int RESULT = sendmmsg(worker->fd, outbox->messages + sent, outbox->count - sent, 0);
+                if(RESULT < 0){
+                        if(errno == EINTR){
+                                continue;
+                        }
+                        worker->dropped += outbox->count - sent;
+                        break;
+                }
+                sent += RESULT;
+        }
+        worker->sent += sent;
+        outbox->count = 0;
+}
+
+/* A join for a match of another worker is answered with that worker's
+ * port; one for a match of this worker opens it if need be, and points
+ * the player's states at the sender. Inputs are applied to the next
+ * tick, and only ever the newest. */
+static void handlePacket(struct worker *const worker, const unsigned char *const DATA, const size_t SIZE, const struct sockaddr_storage *const ADDRESS, const socklen_t LENGTH){
+        struct protocol_message message;
+        if(readMessage(DATA, SIZE, &message)){
+                worker->rejected++;
+                return;
+        }
+
+        if(message.type == PROTOCOL_JOIN){
+                const unsigned HOME = message.key % worker->server->count;
+                unsigned flags = 0;
+                if(HOME == worker->id){
+                        uint32_t index = findSlot(worker, message.key);
+                        if(index == NO_SLOT){
+                                index = openSlot(worker, message.key);
+                        }
+                        if(index != NO_SLOT){
+                                struct client *const client = &worker->slots[index].clients[message.player - 1];
+                                client->joined = 1;
+                                client->address = *ADDRESS;
+                                client->length = LENGTH;
+                                client->heard = worker->now;
+                                flags = PROTOCOL_ACCEPTED;
+                        }
+                }
+
+                unsigned char *const packet = queuePacket(worker, ADDRESS, LENGTH);
+                worker->outbox.iovecs[worker->outbox.count - 1].iov_len = writeWelcome(packet, message.key, message.player, flags, worker->server->count, worker->server->port + HOME);
+                return;
+        }
+
+        if(message.type != PROTOCOL_INPUT){
+                worker->rejected++;
+                return;
+        }
+        const uint32_t INDEX = findSlot(worker, message.key);
+        if(INDEX == NO_SLOT || !worker->slots[INDEX].clients[message.player - 1].joined){
+                worker->rejected++;
+                return;
+        }
+
+        /* inputs only count from where the player joined, so that no one
+         * who guesses a key can steer the paddle or take the player's
+         * states; a player whose address changes must join again */
+        struct slot *const slot = &worker->slots[INDEX];
+        struct client *const client = &slot->clients[message.player - 1];
+        if(LENGTH != client->length || memcmp(ADDRESS, &client->address, LENGTH)){
+                worker->rejected++;
+                return;
+        }
+
+        if((int32_t)(message.sequence - client->sequence) > 0){
+                const int Y_VEL = (message.y_vel > PROTOCOL_PADDLE_SPEED) ? PROTOCOL_PADDLE_SPEED : ((message.y_vel < -PROTOCOL_PADDLE_SPEED) ? -PROTOCOL_PADDLE_SPEED : message.y_vel);
+                client->sequence = message.sequence;
+                ((message.player == 1) ? &slot->world.player1 : &slot->world.player2)->avatar.y_vel = Y_VEL;
+        }
+        if((int32_t)(message.ack - client->ack) > 0 && message.ack <= slot->tick){
+                client->ack = message.ack;
+        }
+        client->heard = worker->now;
+}
+
+static uint64_t nanoseconds(void){
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t)now.tv_sec*1000000000u + now.tv_nsec;
+}
+
+/* Returns NO_SLOT once every slot is taken */
+static uint32_t openSlot(struct worker *const worker, const uint32_t KEY){
+        if(!worker->free_count){
+                return NO_SLOT;
+        }
+
+        const uint32_t INDEX = worker->free[--worker->free_count];
+        struct slot *const slot = &worker->slots[INDEX];
+        slot->world = (struct world)WORLD_INITIALIZER;
+        initWorld(&slot->world, matchSeed(worker->server->seed, KEY));
+        slot->key = KEY;
+        slot->tick = 0;
+        slot->finished = 0;
+        memset(slot->clients, 0, sizeof(slot->clients));
+        memset(slot->history, 0, sizeof(slot->history));
+
+        uint32_t i = tableIndex(worker, KEY);
+        while(worker->table[i] != NO_SLOT){
+                i = (i + 1) & worker->table_mask;
+        }
+        worker->table[i] = INDEX;
+        slot->position = worker->active_count;
+        worker->active[worker->active_count++] = INDEX;
+
+        worker->matches++;
+        if(worker->active_count > worker->peak){
+                worker->peak = worker->active_count;
+        }
+
+        return INDEX;
+}
+
+/* Everything a worker will need is allocated here, so that nothing is
+ * in the tick path. The workers' tick timers are staggered across the
+ * tick period to spread their load on shared cores. */
+static unsigned openWorker(struct worker *const worker, struct server *const server, const unsigned ID){
+        memset(worker, 0, sizeof(*worker));
+        worker->server = server;
+        worker->id = ID;
+
+        uint32_t table_size = 1;
+        while(table_size < 2*server->slots){
+                table_size <<= 1;
+        }
+        worker->table_mask = table_size - 1;
+        worker->slots = malloc(sizeof(*worker->slots)*server->slots);
+        worker->free = malloc(sizeof(*worker->free)*server->slots);
+        worker->active = malloc(sizeof(*worker->active)*server->slots);
+        worker->table = malloc(sizeof(*worker->table)*table_size);
+        if(!worker->slots || !worker->free || !worker->active || !worker->table){
+                fprintf(stderr, "*** Error: Unable to allocate %u match slots\n", server->slots);
+                goto err_malloc;
+        }
+        for(unsigned i = 0; i < server->slots; i++){
+                worker->free[i] = server->slots - 1 - i;
+        }
+        worker->free_count = server->slots;
+        memset(worker->table, 0xFF, sizeof(*worker->table)*table_size);
+
+        for(unsigned i = 0; i < SERVER_BATCH; i++){
+                worker->in_iovecs[i] = (struct iovec){ .iov_base = worker->in_packets[i], .iov_len = sizeof(worker->in_packets[i]) };
+                worker->in_messages[i].msg_hdr = (struct msghdr){ .msg_iov = &worker->in_iovecs[i], .msg_iovlen = 1 };
+                worker->outbox.iovecs[i].iov_base = worker->outbox.packets[i];
+                worker->outbox.messages[i].msg_hdr = (struct msghdr){ .msg_iov = &worker->outbox.iovecs[i], .msg_iovlen = 1 };
+        }
+
+        char port[16];
+        snprintf(port, sizeof(port), "%u", server->port + ID);
+        const struct addrinfo HINTS = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM, .ai_flags = AI_PASSIVE };
+        struct addrinfo *local;
+        const int ERROR = getaddrinfo(NULL, port, &HINTS, &local);
+        if(ERROR){
+                fprintf(stderr, "*** Error: Unable to resolve local port %s: %s\n", port, gai_strerror(ERROR));
+                goto err_getaddrinfo;
+        }
+        worker->fd = socket(local->ai_family, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if(worker->fd < 0){
+                fprintf(stderr, "*** Error: Unable to create socket: %s\n", strerror(errno));
+                goto err_socket;
+        }
+        const int BUFFER = SERVER_SOCKET_BUFFER;
+        if(setsockopt(worker->fd, SOL_SOCKET, SO_RCVBUF, &BUFFER, sizeof(BUFFER)) || setsockopt(worker->fd, SOL_SOCKET, SO_SNDBUF, &BUFFER, sizeof(BUFFER))){
+                fprintf(stderr, "*** Warning: Unable to enlarge socket buffers: %s\n", strerror(errno));
+        }
+        if(bind(worker->fd, local->ai_addr, local->ai_addrlen)){
+                fprintf(stderr, "*** Error: Unable to bind to port %s: %s\n", port, strerror(errno));
+                goto err_bind;
+        }
+        freeaddrinfo(local);
+
+        worker->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if(worker->timer < 0){
+                fprintf(stderr, "*** Error: Unable to create tick timer: %s\n", strerror(errno));
+                goto err_timerfd_create;
+        }
+        const long PERIOD = 1000000000l/TICK_RATE;
+        const long OFFSET = PERIOD/server->count*ID + 1;
+        const struct itimerspec TIMER = { .it_interval = { .tv_nsec = PERIOD }, .it_value = { .tv_nsec = OFFSET } };
+        if(timerfd_settime(worker->timer, 0, &TIMER, NULL)){
+                fprintf(stderr, "*** Error: Unable to start tick timer: %s\n", strerror(errno));
+                goto err_timerfd_settime;
+        }
+
+        worker->epoll = epoll_create1(0);
+        if(worker->epoll < 0){
+                fprintf(stderr, "*** Error: Unable to create epoll instance: %s\n", strerror(errno));
+                goto err_epoll_create;
+        }
+        const int FDS[] = { [EVENT_SOCKET] = worker->fd, [EVENT_TIMER] = worker->timer, [EVENT_STOP] = server->stop };
+        for(unsigned i = 0; i < sizeof(FDS)/sizeof(*FDS); i++){
+                struct epoll_event event = { .events = EPOLLIN, .data.u32 = i };
+                if(epoll_ctl(worker->epoll, EPOLL_CTL_ADD, FDS[i], &event)){
+                        fprintf(stderr, "*** Error: Unable to watch worker events: %s\n", strerror(errno));
+                        goto err_epoll_ctl;
+                }
+        }
+
+        return 0;
+
+err_epoll_ctl:
+        close(worker->epoll);
+err_epoll_create:
+err_timerfd_settime:
+        close(worker->timer);
+err_timerfd_create:
+        close(worker->fd);
+        goto err_getaddrinfo;
+err_bind:
+        close(worker->fd);
+err_socket:
+        freeaddrinfo(local);
+err_getaddrinfo:
+err_malloc:
+        free(worker->slots);
+        free(worker->free);
+        free(worker->active);
+        free(worker->table);
+        return 1;
+}
+
+static unsigned parseArgs(const int argc, char *const argv[], struct options *const options){
+        for(int i = 1; i < argc; i++){
+                unsigned long number;
+                if(!strcmp(argv[i], "--port") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 65535, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid port \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->port = number;
+                }else if(!strcmp(argv[i], "--seed") && i + 1 < argc){
+                        if(parseNumber(argv[++i], ULONG_MAX, &options->seed)){
+                                fprintf(stderr, "*** Error: Invalid seed \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                }else if(!strcmp(argv[i], "--slots") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1u << 24, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of slots \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->slots = number;
+                }else if(!strcmp(argv[i], "--workers") && i + 1 < argc){
+                        if(parseNumber(argv[++i], 1024, &number) || !number){
+                                fprintf(stderr, "*** Error: Invalid number of workers \"%s\"\n", argv[i]);
+                                return 1;
+                        }
+                        options->workers = number;
+                }else{
+                        fprintf(stderr, "*** Error: Unknown option \"%s\"\n", argv[i]);
+                        return 1;
+                }
+        }
+
+        if(options->port + options->workers - 1 > 65535){
+                fprintf(stderr, "*** Error: Ports of %u workers from %u run past 65535\n", options->workers, options->port);
+                return 1;
+        }
+
+        return 0;
+}
+
+static unsigned parseNumber(const char *const STRING, const unsigned long MAX, unsigned long *const number){
+        char *end;
+        errno = 0;
+        *number = strtoul(STRING, &end, 10);
+
+        return end == STRING || *end != '\0' || errno || *number > MAX;
+}
+
+/* Each worker runs on a core of its own where there are enough, so its
+ * tick times are those of one core */
+static void printReport(const struct server *const SERVER){
+        struct histogram total = { .count = 0 };
+        printf("worker  matches  peak  ticks  p50_ms  p99_ms  max_ms  overruns  received  sent  dropped  rejected\n");
+        for(unsigned i = 0; i < SERVER->count; i++){
+                const struct worker *const WORKER = &SERVER->workers[i];
+                const struct histogram *const TICKS = &WORKER->ticks;
+                printf("%6u  %7lu  %4u  %5llu  %6.3f  %6.3f  %6.3f  %8lu  %8lu  %4lu  %7lu  %8lu\n", i, WORKER->matches, WORKER->peak, (unsigned long long)TICKS->count,
+                        histogramPercentile(TICKS, 50)/1e6, histogramPercentile(TICKS, 99)/1e6, TICKS->max/1e6, WORKER->overruns, WORKER->received, WORKER->sent, WORKER->dropped, WORKER->rejected);
+                mergeHistogram(&total, TICKS);
+        }
+        printf("Tick time over all workers: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", histogramPercentile(&total, 50)/1e6, histogramPercentile(&total, 99)/1e6, total.max/1e6);
+}
+
+/* Returns the buffer of a new outgoing datagram to ADDRESS, whose size
+ * the caller must set; a full outbox is sent first */
+static unsigned char *queuePacket(struct worker *const worker, const struct sockaddr_storage *const ADDRESS, const socklen_t LENGTH){
+        struct outbox *const outbox = &worker->outbox;
+        if(outbox->count == SERVER_BATCH){
+                flushOutbox(worker);
+        }
+
+        struct msghdr *const header = &outbox->messages[outbox->count].msg_hdr;
+        header->msg_name = (void *)ADDRESS;
+        header->msg_namelen = LENGTH;
+
+        return outbox->packets[outbox->count++];
+}
+
+/* Drains the socket a batch at a time; replies go out with the batch */
+static void receivePackets(struct worker *const worker){
+        for(;;){
+                for(unsigned i = 0; i < SERVER_BATCH; i++){
+                        worker->in_messages[i].msg_hdr.msg_name = &worker->in_addresses[i];
+                        worker->in_messages[i].msg_hdr.msg_namelen = sizeof(worker->in_addresses[i]);
+                }
+                const int RECEIVED = recvmmsg(worker->fd, worker->in_messages, SERVER_BATCH, MSG_DONTWAIT, NULL);
+                if(RECEIVED <= 0){
+                        break;
+                }
+
+                worker->received += RECEIVED;
+                for(int i = 0; i < RECEIVED; i++){
+                        handlePacket(worker, worker->in_packets[i], worker->in_messages[i].msg_len, &worker->in_addresses[i], worker->in_messages[i].msg_hdr.msg_namelen);
+                }
+                flushOutbox(worker);
+                if(RECEIVED < SERVER_BATCH){
+                        break;
+                }
+        }
+}
+
+static void *runWorker(void *const argument){
+        struct worker *const worker = argument;
+
+        /* worker N is pinned to the Nth processor the server may run on,
+         * which under taskset or a cpuset need not be processor N */
+        cpu_set_t allowed;
+        if(!sched_getaffinity(0, sizeof(allowed), &allowed) && worker->server->count <= (unsigned)CPU_COUNT(&allowed)){
+                unsigned skipped = 0;
+                for(unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++){
+                        if(!CPU_ISSET(cpu, &allowed) || skipped++ < worker->id){
+                                continue;
+                        }
+
+                        cpu_set_t cpus;
+                        CPU_ZERO(&cpus);
+                        CPU_SET(cpu, &cpus);
+                        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+                        break;
+                }
+        }
+
+        for(;;){
+                struct epoll_event events[3];
+                const int COUNT = epoll_wait(worker->epoll, events, sizeof(events)/sizeof(*events), -1);
+                if(COUNT < 0 && errno != EINTR){
+                        fprintf(stderr, "*** Error: Unable to wait for worker events: %s\n", strerror(errno));
+                        return NULL;
+                }
+
+                for(int i = 0; i < COUNT; i++){
+                        switch(events[i].data.u32){
+                                case EVENT_SOCKET:
+                                        receivePackets(worker);
+                                        break;
+                                case EVENT_TIMER:
+                                        tickWorker(worker);
+                                        break;
+                                case EVENT_STOP:
+                                        return NULL;
+                        }
+                }
+        }
+}
+
+/* The state is a delta from the newest the player has acknowledged, if
+ * that is still in the history */
+static void sendState(struct worker *const worker, const struct slot *const SLOT, const unsigned PLAYER){
+        const struct client *const CLIENT = &SLOT->clients[PLAYER - 1];
+        const struct protocol_state *const STATE = &SLOT->history[SLOT->tick % PROTOCOL_HISTORY];
+        const struct protocol_state *const BASE = &SLOT->history[CLIENT->ack % PROTOCOL_HISTORY];
+        const unsigned DELTA = CLIENT->ack && SLOT->tick - CLIENT->ack < PROTOCOL_HISTORY && BASE->tick == CLIENT->ack;
+
+        unsigned char *const packet = queuePacket(worker, &CLIENT->address, CLIENT->length);
+        worker->outbox.iovecs[worker->outbox.count - 1].iov_len = writeState(packet, SLOT->key, PLAYER, SLOT->finished ? PROTOCOL_FINISHED : 0, CLIENT->sequence, STATE, DELTA ? BASE : NULL);
+}
+
+static void stopWorkers(struct server *const server, const unsigned STARTED){
+        const uint64_t STOP = 1;
+        if(write(server->stop, &STOP, sizeof(STOP)) != sizeof(STOP)){
+                fprintf(stderr, "*** Error: Unable to stop workers: %s\n", strerror(errno));
+        }
+        for(unsigned i = 0; i < STARTED; i++){
+                pthread_join(server->workers[i].thread, NULL);
+        }
+}
+
+/* Fibonacci hashing */
+static uint32_t tableIndex(const struct worker *const WORKER, const uint32_t KEY){
+        return (KEY*0x9E3779B9u >> 8) & WORKER->table_mask;
+}
+
+/* Every match of the worker is stepped and its state sent in one pass,
+ * so the datagrams of many matches go out in each sendmmsg() call. A
+ * match starts once both players have joined, and is dropped once
+ * either falls silent. */
+static void tickWorker(struct worker *const worker){
+        uint64_t expirations;
+        if(read(worker->timer, &expirations, sizeof(expirations)) != sizeof(expirations)){
+                return;
+        }
+        worker->overruns += expirations - 1;
+
+        const uint64_t START = nanoseconds();
+        worker->now++;
+        for(unsigned i = 0; i < worker->active_count;){
+                const uint32_t INDEX = worker->active[i];
+                struct slot *const slot = &worker->slots[INDEX];
+                const struct client *const CLIENTS = slot->clients;
+                const unsigned SILENT = (CLIENTS[0].joined && worker->now - CLIENTS[0].heard > SERVER_TIMEOUT) || (CLIENTS[1].joined && worker->now - CLIENTS[1].heard > SERVER_TIMEOUT);
+                if(SILENT || (slot->finished && worker->now - slot->finished > SERVER_LINGER)){
+                        closeSlot(worker, INDEX);
+                        continue;
+                }
+                i++;
+                if(!CLIENTS[0].joined || !CLIENTS[1].joined){
+                        continue;
+                }
+
+                if(!slot->finished){
+                        stepWorld(&slot->world);
+                        slot->tick++;
+                        worldState(&slot->world, slot->tick, &slot->history[slot->tick % PROTOCOL_HISTORY]);
+                        if(slot->world.player1.score >= MATCH_POINTS || slot->world.player2.score >= MATCH_POINTS){
+                                slot->finished = worker->now;
+                        }
+                }
+                sendState(worker, slot, 1);
+                sendState(worker, slot, 2);
+        }
+        flushOutbox(worker);
+        recordHistogram(&worker->ticks, nanoseconds() - START);
+}
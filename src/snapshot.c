@@ -0,0 +1,111 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snapshot.h"
+#include "world.h"
+
+static void interpolateBox(const struct box *const FROM, const double ALPHA, struct box *const box);
+
+void freeSnapshots(struct snapshots *const snapshots){
+        free(snapshots->slots[0].x);
+        free(snapshots->slots[0].alive);
+}
+
+/* The producer starts with slot 0 and the consumer with slot 2 */
+unsigned initSnapshots(struct snapshots *const snapshots, const unsigned BALLS, const unsigned BRICKS){
+        int32_t *positions = NULL;
+        if(BALLS){
+                positions = malloc(2*sizeof(*positions)*SNAPSHOT_SLOTS*BALLS);
+                if(!positions){
+                        fprintf(stderr, "*** Error: Unable to allocate snapshots of %u balls\n", BALLS);
+                        return 1;
+                }
+        }
+
+        const unsigned WORDS = (BRICKS + 63)/64;
+        uint64_t *alive = NULL;
+        if(WORDS){
+                alive = malloc(sizeof(*alive)*SNAPSHOT_SLOTS*WORDS);
+                if(!alive){
+                        fprintf(stderr, "*** Error: Unable to allocate snapshots of %u bricks\n", BRICKS);
+                        free(positions);
+                        return 1;
+                }
+        }
+
+        for(unsigned i = 0; i < SNAPSHOT_SLOTS; i++){
+                struct snapshot *const snapshot = &snapshots->slots[i];
+                snapshot->balls = BALLS;
+                snapshot->x = BALLS ? positions + 2*i*BALLS : NULL;
+                snapshot->y = BALLS ? snapshot->x + BALLS : NULL;
+                snapshot->alive = WORDS ? alive + i*WORDS : NULL;
+                snapshot->field_version = 0;
+        }
+        snapshots->back = 0;
+        snapshots->middle = 1;
+        snapshots->front = 2;
+
+        return 0;
+}
+
+/* Positions are blended ALPHA of the way from before the tick to after
+ * it; the arena balls are not interpolated */
+void interpolateSnapshot(const struct snapshot *const SNAPSHOT, const double ALPHA, struct world *const world){
+        *world = SNAPSHOT->world;
+        if(!SNAPSHOT->continuous){
+                return;
+        }
+
+        interpolateBox(&SNAPSHOT->previous[0], ALPHA, &world->ball.box);
+        interpolateBox(&SNAPSHOT->previous[1], ALPHA, &world->player1.avatar.box);
+        interpolateBox(&SNAPSHOT->previous[2], ALPHA, &world->player2.avatar.box);
+}
+
+/* Takes the newest published snapshot, if there is one the renderer has
+ * not yet seen, and otherwise keeps the current one */
+const struct snapshot *latestSnapshot(struct snapshots *const snapshots){
+        if(__atomic_load_n(&snapshots->middle, __ATOMIC_RELAXED) & SNAPSHOT_FRESH){
+                const unsigned MIDDLE = __atomic_exchange_n(&snapshots->middle, snapshots->front, __ATOMIC_ACQ_REL);
+                snapshots->front = MIDDLE & ~SNAPSHOT_FRESH;
+        }
+
+        return &snapshots->slots[snapshots->front];
+}
+
+/* Publishes the back slot, which the producer must have filled in */
+void publishSnapshot(struct snapshots *const snapshots){
+        const unsigned MIDDLE = __atomic_exchange_n(&snapshots->middle, snapshots->back | SNAPSHOT_FRESH, __ATOMIC_ACQ_REL);
+        snapshots->back = MIDDLE & ~SNAPSHOT_FRESH;
+}
+
+static void interpolateBox(const struct box *const FROM, const double ALPHA, struct box *const box){
+        box->x = FROM->x + (int)(ALPHA*(box->x - FROM->x));
+        box->y = FROM->y + (int)(ALPHA*(box->y - FROM->y));
+}
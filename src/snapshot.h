@@ -0,0 +1,76 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "world.h"
+
+#define SNAPSHOT_SLOTS 3
+#define SNAPSHOT_FRESH 0x4u
+
+/* The state of the game after one tick, as handed to the renderer.
+ * PREVIOUS holds where the ball and paddles were before the tick, so
+ * that frames between ticks may be interpolated, unless the tick moved
+ * them discontinuously (a point, reset or seek). TIME is when the tick
+ * was due and INPUT_TIME the time of the last paddle input it includes,
+ * both in performance counter units. The multi-ball arena, if any, is
+ * copied into X and Y, and which of the field's bricks are unbroken
+ * into ALIVE, along with the field's VERSION. */
+struct snapshot{
+        struct world world;
+        struct box previous[3];
+        unsigned continuous;
+        uint64_t time;
+        uint64_t input_time;
+        unsigned balls;
+        int32_t *x;
+        int32_t *y;
+        uint64_t *alive;
+        unsigned long field_version;
+};
+
+/* Triple buffer: the simulation fills the back slot while the renderer
+ * draws the front one, and each swaps its slot with the middle one by a
+ * single atomic exchange, so neither ever waits on the other. MIDDLE
+ * carries SNAPSHOT_FRESH while it holds a snapshot not yet taken. */
+struct snapshots{
+        struct snapshot slots[SNAPSHOT_SLOTS];
+        unsigned back;
+        unsigned middle __attribute__((aligned(64)));
+        unsigned front __attribute__((aligned(64)));
+};
+
+void freeSnapshots(struct snapshots *const snapshots);
+unsigned initSnapshots(struct snapshots *const snapshots, const unsigned BALLS, const unsigned BRICKS);
+void interpolateSnapshot(const struct snapshot *const SNAPSHOT, const double ALPHA, struct world *const world);
+const struct snapshot *latestSnapshot(struct snapshots *const snapshots);
+void publishSnapshot(struct snapshots *const snapshots);
+
+#endif
@@ -0,0 +1,109 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "field.h"
+#include "world.h"
+
+#define MATCH_SEED 0x5EEDu
+
+/* Each check sets up a world in which stepWorld() once went wrong and
+ * returns nonzero should it still do so */
+typedef unsigned (*check_fn)(void);
+
+static unsigned checkPaddleFace(void);
+static unsigned checkWallBrick(void);
+
+int main(void){
+        static const check_fn CHECKS[] = { checkPaddleFace, checkWallBrick };
+        const unsigned COUNT = sizeof(CHECKS)/sizeof(*CHECKS);
+
+        unsigned failures = 0;
+        for(unsigned i = 0; i < COUNT; i++){
+                failures += CHECKS[i]() != 0;
+        }
+        if(failures){
+                fprintf(stderr, "*** Error: %u of %u world checks failed\n", failures, COUNT);
+                return 1;
+        }
+
+        return 0;
+}
+
+/* A ball rising into the underside of a paddle must bounce off its
+ * bottom face rather than end the tick inside it */
+static unsigned checkPaddleFace(void){
+        struct world world = WORLD_INITIALIZER;
+        initWorld(&world, MATCH_SEED);
+        world.player1.avatar.box.y = 377;
+        world.ball.box.x = 11;
+        world.ball.box.y = 427;
+        world.ball.x_vel = 4;
+        world.ball.y_vel = -3;
+        stepWorld(&world);
+
+        const struct box *const BALL = &world.ball.box;
+        const struct box *const PADDLE = &world.player1.avatar.box;
+        if(BALL->x < PADDLE->x + PADDLE->w && PADDLE->x < BALL->x + BALL->w && BALL->y < PADDLE->y + PADDLE->h && PADDLE->y < BALL->y + BALL->h){
+                fprintf(stderr, "*** Error: Ball ended the tick inside a paddle at (%d,%d)\n", BALL->x, BALL->y);
+                return 1;
+        }
+
+        return 0;
+}
+
+/* A ball less than a unit from the top wall must turn there before its
+ * path is swept for bricks, or it ends the tick inside the one it would
+ * have met on the way back down */
+static unsigned checkWallBrick(void){
+        const struct brick BRICK = { .box = { .x = 216, .y = 18, .w = 24, .h = 18 }, .strength = BRICK_SOLID };
+        struct field field;
+        if(initField(&field, &BRICK, 1)){
+                fprintf(stderr, "*** Error: Unable to set up brick\n");
+                return 1;
+        }
+
+        struct world world = WORLD_INITIALIZER;
+        initWorld(&world, MATCH_SEED);
+        world.field = &field;
+        world.ball.box.x = 198;
+        world.ball.box.y = 0;
+        world.ball.x_vel = 1;
+        world.ball.y_vel = -3;
+        stepWorld(&world);
+
+        const struct box *const BALL = &world.ball.box;
+        const unsigned INSIDE = BALL->x < BRICK.box.x + BRICK.box.w && BRICK.box.x < BALL->x + BALL->w && BALL->y < BRICK.box.y + BRICK.box.h && BRICK.box.y < BALL->y + BALL->h;
+        freeField(&field);
+        if(INSIDE){
+                fprintf(stderr, "*** Error: Ball ended the tick inside a brick at (%d,%d)\n", BALL->x, BALL->y);
+                return 1;
+        }
+
+        return 0;
+}
@@ -0,0 +1,142 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "video.h"
+#include "world.h"
+
+#define FRAME_HEADER "FRAME\n"
+
+static void convertRGB(unsigned char *const rgb, const uint32_t *const PIXELS);
+static void convertYCbCr(unsigned char *const planes, const uint32_t *const PIXELS);
+
+const char *const VIDEO_FORMAT_NAMES[VIDEO_FORMATS] = {
+        [VIDEO_Y4M] = "y4m",
+        [VIDEO_RGB] = "rgb"
+};
+
+/* Standard output is flushed but left open */
+unsigned closeVideo(struct video *const video){
+        free(video->buffer);
+        video->buffer = NULL;
+
+        const unsigned FAILED = (video->file == stdout) ? fflush(video->file) != 0 : fclose(video->file) != 0;
+        video->file = NULL;
+        if(FAILED){
+                fprintf(stderr, "*** Error: Unable to write video \"%s\": %s\n", video->path, strerror(errno));
+                return 1;
+        }
+
+        return 0;
+}
+
+/* PATH is VIDEO_STDOUT to stream to standard output */
+unsigned openVideo(struct video *const video, const char *const PATH, const enum video_format FORMAT, const unsigned FPS){
+        *video = (struct video){ .path = PATH, .format = FORMAT, .frame_size = 3*WIDTH*HEIGHT };
+
+        video->buffer = malloc(video->frame_size);
+        if(!video->buffer){
+                fprintf(stderr, "*** Error: Unable to allocate video frame\n");
+                return 1;
+        }
+
+        video->file = strcmp(PATH, VIDEO_STDOUT) ? fopen(PATH, "wb") : stdout;
+        if(!video->file){
+                fprintf(stderr, "*** Error: Unable to create video \"%s\": %s\n", PATH, strerror(errno));
+                goto err_open;
+        }
+
+        if(FORMAT == VIDEO_Y4M && fprintf(video->file, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C444\n", WIDTH, HEIGHT, FPS) < 0){
+                fprintf(stderr, "*** Error: Unable to write video \"%s\": %s\n", PATH, strerror(errno));
+                goto err_header;
+        }
+
+        return 0;
+
+err_header:
+        if(video->file != stdout){
+                fclose(video->file);
+        }
+err_open:
+        free(video->buffer);
+        video->buffer = NULL;
+        return 1;
+}
+
+/* PIXELS is an opaque ARGB8888 frame of WIDTH x HEIGHT */
+unsigned writeFrame(struct video *const video, const uint32_t *const PIXELS){
+        if(video->format == VIDEO_Y4M){
+                convertYCbCr(video->buffer, PIXELS);
+                if(fwrite(FRAME_HEADER, 1, sizeof(FRAME_HEADER) - 1, video->file) != sizeof(FRAME_HEADER) - 1){
+                        goto err_write;
+                }
+        }else{
+                convertRGB(video->buffer, PIXELS);
+        }
+
+        if(fwrite(video->buffer, 1, video->frame_size, video->file) != video->frame_size){
+                goto err_write;
+        }
+        video->frames++;
+
+        return 0;
+
+err_write:
+        fprintf(stderr, "*** Error: Unable to write frame %lu of video \"%s\": %s\n", video->frames, video->path, strerror(errno));
+        return 1;
+}
+
+static void convertRGB(unsigned char *const rgb, const uint32_t *const PIXELS){
+        for(unsigned i = 0; i < WIDTH*HEIGHT; i++){
+                rgb[3*i] = PIXELS[i] >> 16;
+                rgb[3*i + 1] = PIXELS[i] >> 8;
+                rgb[3*i + 2] = PIXELS[i];
+        }
+}
+
+/* Studio range BT.601 in 8-bit fixed point, as used by most encoders
+ * for standard definition; one plane each of Y, Cb and Cr */
+static void convertYCbCr(unsigned char *const planes, const uint32_t *const PIXELS){
+        unsigned char *const y = planes;
+        unsigned char *const cb = y + WIDTH*HEIGHT;
+        unsigned char *const cr = cb + WIDTH*HEIGHT;
+
+        for(unsigned i = 0; i < WIDTH*HEIGHT; i++){
+                const int R = (PIXELS[i] >> 16) & 0xFF;
+                const int G = (PIXELS[i] >> 8) & 0xFF;
+                const int B = PIXELS[i] & 0xFF;
+
+                y[i] = ((66*R + 129*G + 25*B + 128) >> 8) + 16;
+                cb[i] = ((-38*R - 74*G + 112*B + 128) >> 8) + 128;
+                cr[i] = ((112*R - 94*G - 18*B + 128) >> 8) + 128;
+        }
+}
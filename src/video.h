@@ -0,0 +1,61 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define VIDEO_STDOUT "-"
+
+enum video_format{
+        VIDEO_Y4M,
+        VIDEO_RGB,
+        VIDEO_FORMATS
+};
+
+/* A stream of uncompressed frames for an external encoder. Y4M carries
+ * its own size and frame rate, with full resolution BT.601 YCbCr;
+ * raw RGB is packed 24-bit pixels with no header at all, to be read
+ * with the size and rate given to the encoder. */
+struct video{
+        FILE *file;
+        const char *path;
+        enum video_format format;
+        unsigned char *buffer;
+        size_t frame_size;
+        unsigned long frames;
+};
+
+extern const char *const VIDEO_FORMAT_NAMES[VIDEO_FORMATS];
+
+unsigned closeVideo(struct video *const video);
+unsigned openVideo(struct video *const video, const char *const PATH, const enum video_format FORMAT, const unsigned FPS);
+unsigned writeFrame(struct video *const video, const uint32_t *const PIXELS);
+
+#endif
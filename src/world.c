@@ -0,0 +1,401 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+
+#include "field.h"
+#include "world.h"
+
+/* More paddle bounces in one tick than any speed the court could fit,
+ * so that paddles large enough to touch the ball at once on both sides
+ * cannot stall the step */
+#define MAX_BOUNCES 64
+
+/* Returned by sweepBricks() when the ball moved without hitting any */
+#define SWEPT 0x80000000u
+
+static unsigned sweepBricks(struct world *const world, int64_t *const y, int64_t *const left, const int64_t LIMIT, const int64_t SPEED, const int64_t BOTTOM);
+static unsigned sweepPaddle(const struct character *const BALL, const struct box *const PADDLE, const int64_t Y, const int64_t SPAN, const int64_t SPEED, const int64_t BOTTOM, struct field_hit *const hit, int *const y_vel);
+static int64_t sweepY(struct character *const ball, const int64_t Y, const int64_t TIME, const int64_t BOTTOM);
+
+/* Where something bouncing between 0 and LIMIT would be, had it
+ * travelled to POSITION with nothing in the way, and whether it would
+ * then be heading back the other way */
+int64_t foldPosition(const int64_t POSITION, const int64_t LIMIT, unsigned *const turned){
+        if(POSITION >= 0 && POSITION < LIMIT){
+                *turned = 0;
+                return POSITION;
+        }
+        if(LIMIT <= 0){
+                *turned = 0;
+                return 0;
+        }
+
+        const int64_t CROSSINGS = POSITION/LIMIT - (POSITION % LIMIT < 0);
+        const int64_t OFFSET = POSITION - CROSSINGS*LIMIT;
+        *turned = CROSSINGS & 1;
+
+        return *turned ? LIMIT - OFFSET : OFFSET;
+}
+
+/* FNV-1a over every field, so that two runs can be compared cheaply */
+uint64_t hashWorld(const struct world *const world){
+        const struct character *const CHARACTERS[] = { &world->ball, &world->player1.avatar, &world->player2.avatar };
+        uint64_t hash = 0xCBF29CE484222325u;
+        for(unsigned i = 0; i < sizeof(CHARACTERS)/sizeof(*CHARACTERS); i++){
+                const int FIELDS[] = { CHARACTERS[i]->box.x, CHARACTERS[i]->box.y, CHARACTERS[i]->box.w, CHARACTERS[i]->box.h, CHARACTERS[i]->x_vel, CHARACTERS[i]->y_vel };
+                for(unsigned j = 0; j < sizeof(FIELDS)/sizeof(*FIELDS); j++){
+                        hash = (hash ^ (uint32_t)FIELDS[j])*0x100000001B3u;
+                }
+        }
+        hash = (hash ^ world->player1.score)*0x100000001B3u;
+        hash = (hash ^ world->player2.score)*0x100000001B3u;
+        if(world->field){
+                hash = (hash ^ world->field->version)*0x100000001B3u;
+        }
+
+        return (hash ^ world->rng)*0x100000001B3u;
+}
+
+void initWorld(struct world *const world, const uint64_t SEED){
+        seedWorld(world, SEED);
+        placePaddles(world);
+        resetBall(world);
+}
+
+/* splitmix64: advances STATE and returns the next number of its
+ * sequence, for every generator in the game to share */
+uint64_t mixRandom(uint64_t *const state){
+        uint64_t z = (*state += 0x9E3779B97F4A7C15u);
+        z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9u;
+        z = (z ^ (z >> 27))*0x94D049BB133111EBu;
+        return z ^ (z >> 31);
+}
+
+void moveCharacter(struct character *const character){
+        const int X_START = character->box.x;
+        const int X_END = X_START + (character->box.w - 1);
+        const int X_VEL = character->x_vel;
+        const int Y_START = character->box.y;
+        const int Y_END = Y_START + (character->box.h - 1);
+        const int Y_VEL = character->y_vel;
+
+        character->box.x = (X_END + X_VEL > WIDTH - 1) ? WIDTH - character->box.w : ((X_START + X_VEL < 0) ? 0 : X_START + X_VEL);
+        character->box.y = (Y_END + Y_VEL > HEIGHT - 1) ? HEIGHT - character->box.h : ((Y_START + Y_VEL < 0) ? 0 : Y_START + Y_VEL);
+}
+
+void paddleBounce(struct world *const world){
+        world->ball.y_vel = worldRandom(world) % 6;
+        world->ball.y_vel *= (worldRandom(world) % 2) ? -1 : 1;
+}
+
+void placePaddles(struct world *const world){
+        struct box *const PADDLE1 = &world->player1.avatar.box;
+        struct box *const PADDLE2 = &world->player2.avatar.box;
+
+        PADDLE1->x = (2*PADDLE1->w > WIDTH) ? 0 : PADDLE1->w;
+        PADDLE1->y = (HEIGHT - PADDLE1->h)/2;
+
+        PADDLE2->x = (WIDTH < 2*PADDLE2->w) ? 0 : WIDTH - 2*PADDLE2->w;
+        PADDLE2->y = (HEIGHT - PADDLE2->h)/2;
+}
+
+void resetBall(struct world *const world){
+        world->ball.box.x = (WIDTH - world->ball.box.w)/2;
+        world->ball.box.y = worldRandom(world) % (HEIGHT - world->ball.box.h);
+
+        paddleBounce(world);
+}
+
+void resetWorld(struct world *const world){
+        world->player1.score = 0;
+        world->player2.score = 0;
+
+        placePaddles(world);
+
+        world->ball.x_vel = 5;
+        resetBall(world);
+
+        if(world->field){
+                resetField(world->field);
+        }
+}
+
+/* Each world has its own generator so that a match depends on nothing
+ * but its seed and its inputs */
+void seedWorld(struct world *const world, const uint64_t SEED){
+        world->rng = SEED;
+}
+
+/* The ball's path over the tick is swept, rather than only its final
+ * position tested, so that it cannot pass through a paddle however fast
+ * it moves. Time is measured in pixels of horizontal travel, which a
+ * paddle bounce does not change, and the ball's height in 1/SPEED of a
+ * pixel, so that the point of impact is exact and any number of wall
+ * bounces are folded in at once; the height is only rounded at the end
+ * of a tick in which a paddle changed its course. The paddles are taken
+ * to be where they are at the end of the tick, and the ball bounces off
+ * whichever face of one it meets first, being served back only from
+ * the front. Bricks are swept for before each paddle contact or goal,
+ * and the ball bounces off the first it meets. */
+unsigned stepWorld(struct world *const world){
+        struct character *const ball = &world->ball;
+        const struct box *const PLAYER1 = &world->player1.avatar.box;
+        const struct box *const PLAYER2 = &world->player2.avatar.box;
+
+        moveCharacter(&world->player1.avatar);
+        moveCharacter(&world->player2.avatar);
+
+        const int64_t SPEED = ball->x_vel ? abs(ball->x_vel) : 1;
+        const int64_t BOTTOM = (int64_t)(HEIGHT - ball->box.h)*SPEED;
+        const int X_MAX = WIDTH - ball->box.w;
+        int64_t y = (int64_t)ball->box.y*SPEED;
+        int64_t left = SPEED;
+        unsigned events = 0;
+        unsigned bounces = 0;
+
+        while(left && bounces < MAX_BOUNCES){
+                const int DIRECTION = (ball->x_vel > 0) - (ball->x_vel < 0);
+                if(!DIRECTION){
+                        y = sweepY(ball, y, left, BOTTOM);
+                        break;
+                }
+
+                /* the ball meets the paddle ahead when it reaches its face,
+                 * or at once should the paddle have moved onto it */
+                const unsigned LEFT_SIDE = DIRECTION < 0;
+                const struct box *const PADDLE = LEFT_SIDE ? PLAYER1 : PLAYER2;
+                const int FACE = LEFT_SIDE ? PADDLE->x + PADDLE->w : PADDLE->x - ball->box.w;
+                const unsigned AHEAD = LEFT_SIDE ? ball->box.x + ball->box.w > PADDLE->x : ball->box.x < PADDLE->x + PADDLE->w;
+                const int64_t CONTACT = (FACE - ball->box.x)*DIRECTION > 0 ? (FACE - ball->box.x)*DIRECTION : 0;
+                struct field_hit contact = { .time = CONTACT, .y = y, .vertical = 1 };
+                int y_vel = ball->y_vel;
+                unsigned player = LEFT_SIDE ? 0 : 1;
+                unsigned struck = 0;
+                if(AHEAD && CONTACT < left){
+                        unsigned turned;
+                        contact.y = foldPosition(y + ball->y_vel*CONTACT, BOTTOM, &turned);
+                        struck = contact.y < (int64_t)(PADDLE->y + PADDLE->h)*SPEED && contact.y + (int64_t)ball->box.h*SPEED > (int64_t)PADDLE->y*SPEED;
+                }
+
+                /* failing that, it bounces off the top or bottom of that
+                 * paddle, or off any face of the other should it get across
+                 * it, whichever it meets first, without being served back */
+                const struct box *const OTHER = LEFT_SIDE ? PLAYER2 : PLAYER1;
+                const int GOAL = LEFT_SIDE ? ball->box.x : X_MAX - ball->box.x;
+                const int64_t REACH = (GOAL < left) ? GOAL : left;
+                struct field_hit hit;
+                int hit_y_vel;
+                if(!struck && AHEAD && CONTACT < REACH && sweepPaddle(ball, PADDLE, y, left, SPEED, BOTTOM, &hit, &hit_y_vel) && hit.time <= GOAL){
+                        contact = hit;
+                        y_vel = hit_y_vel;
+                        struck = 1;
+                }
+                if(ball->box.x - (LEFT_SIDE ? REACH : 0) < OTHER->x + OTHER->w && ball->box.x + ball->box.w + (LEFT_SIDE ? 0 : REACH) > OTHER->x && sweepPaddle(ball, OTHER, y, left, SPEED, BOTTOM, &hit, &hit_y_vel) && hit.time <= GOAL && (!struck || hit.time < contact.time)){
+                        contact = hit;
+                        y_vel = hit_y_vel;
+                        player = !player;
+                        struck = 1;
+                }
+
+                if(world->field){
+                        const int64_t LIMIT = struck ? contact.time : REACH;
+                        const unsigned SWEEP = sweepBricks(world, &y, &left, LIMIT, SPEED, BOTTOM);
+                        if(SWEEP){
+                                bounces += !(SWEEP & SWEPT);
+                                events |= SWEEP & ~SWEPT;
+                                continue;
+                        }
+                }
+
+                if(struck){
+                        y = contact.y;
+                        left -= contact.time;
+                        if(contact.vertical && player == !LEFT_SIDE){
+                                ball->box.x = FACE;
+                                ball->x_vel *= -1;
+                                paddleBounce(world);
+                        }else{
+                                ball->box.x += DIRECTION*contact.time;
+                                ball->x_vel *= contact.vertical ? -1 : 1;
+                                ball->y_vel = contact.vertical ? y_vel : -y_vel;
+                        }
+                        bounces++;
+                        events |= player ? WORLD_HIT_PLAYER2 : WORLD_HIT_PLAYER1;
+                        continue;
+                }
+
+                if(GOAL <= left){
+                        if(LEFT_SIDE){
+                                world->player2.score++;
+                        }else{
+                                world->player1.score++;
+                        }
+                        resetBall(world);
+                        return events | (LEFT_SIDE ? WORLD_SCORE_PLAYER2 : WORLD_SCORE_PLAYER1);
+                }
+
+                y = sweepY(ball, y, left, BOTTOM);
+                ball->box.x += DIRECTION*left;
+                left = 0;
+        }
+        /* rounding down cannot carry the ball into a brick it stopped short
+         * of, whose edges are whole pixels */
+        ball->box.y = world->field ? y/SPEED : (y + SPEED/2)/SPEED;
+
+        return events;
+}
+
+uint32_t worldRandom(struct world *const world){
+        return mixRandom(&world->rng) >> 32;
+}
+
+/* Moves the ball through the bricks for up to LIMIT of stepWorld()'s
+ * units, a stretch at a time between the walls, stopping at the first
+ * brick it hits; returns the events of the hit, SWEPT if the ball moved
+ * without one, or nothing if it reached LIMIT without one, leaving
+ * stepWorld() to carry on from where it started */
+static unsigned sweepBricks(struct world *const world, int64_t *const y, int64_t *const left, const int64_t LIMIT, const int64_t SPEED, const int64_t BOTTOM){
+        struct character *const ball = &world->ball;
+        if(!LIMIT){
+                return 0;
+        }
+
+        int64_t span = LIMIT;
+        if(ball->y_vel){
+                int64_t wall = (ball->y_vel > 0) ? (BOTTOM - *y)/ball->y_vel : *y/-ball->y_vel;
+
+                /* a ball within a unit of the wall it is heading for turns
+                 * around there, so that no sweep ever crosses the fold */
+                if(!wall){
+                        ball->y_vel *= -1;
+                        wall = (ball->y_vel > 0) ? (BOTTOM - *y)/ball->y_vel : *y/-ball->y_vel;
+                }
+                if(wall < span){
+                        span = (wall > 1) ? wall : 1;
+                }
+        }
+
+        const int DIRECTION = (ball->x_vel > 0) - (ball->x_vel < 0);
+        const struct field_sweep SWEEP = { .x = ball->box.x, .y = *y, .direction = DIRECTION, .y_vel = ball->y_vel, .span = span, .scale = SPEED, .w = ball->box.w, .h = ball->box.h };
+        struct field_hit hit;
+        if(sweepField(world->field, &SWEEP, &hit)){
+                ball->box.x += DIRECTION*hit.time;
+                *y = hit.y;
+                *left -= hit.time;
+                if(hit.vertical){
+                        ball->x_vel *= -1;
+                }else{
+                        ball->y_vel *= -1;
+                }
+
+                return WORLD_HIT_BRICK | (hitBrick(world->field, hit.brick) ? WORLD_BREAK_BRICK : 0);
+        }
+
+        if(span == LIMIT){
+                return 0;
+        }
+        *y = sweepY(ball, *y, span, BOTTOM);
+        ball->box.x += DIRECTION*span;
+        *left -= span;
+
+        return SWEPT;
+}
+
+/* Sweeps the ball for up to SPAN of stepWorld()'s units against the
+ * whole of PADDLE, a stretch between the walls at a time, each ending
+ * the unit after the ball turns so that a face met on the way in is not
+ * missed; Y_VEL is set to the ball's vertical speed when it meets the
+ * paddle */
+static unsigned sweepPaddle(const struct character *const BALL, const struct box *const PADDLE, const int64_t Y, const int64_t SPAN, const int64_t SPEED, const int64_t BOTTOM, struct field_hit *const hit, int *const y_vel){
+        const int DIRECTION = (BALL->x_vel > 0) - (BALL->x_vel < 0);
+        /* the ball can only meet the paddle while it is across it */
+        const int64_t ENTER = (DIRECTION > 0) ? PADDLE->x - (BALL->box.x + BALL->box.w) : BALL->box.x - (PADDLE->x + PADDLE->w);
+        const int64_t LEAVE = (DIRECTION > 0) ? PADDLE->x + PADDLE->w - BALL->box.x : BALL->box.x + BALL->box.w - PADDLE->x;
+        const int64_t STOP = (LEAVE < SPAN) ? LEAVE : SPAN;
+        int64_t start = (ENTER > 0) ? ENTER : 0;
+        unsigned turned;
+        int64_t y = foldPosition(Y + BALL->y_vel*start, BOTTOM, &turned);
+        int velocity = turned ? -BALL->y_vel : BALL->y_vel;
+        const int64_t TOP = (int64_t)PADDLE->y*SPEED;
+        const int64_t END = (int64_t)(PADDLE->y + PADDLE->h)*SPEED;
+        const int64_t TALL = (int64_t)BALL->box.h*SPEED;
+
+        if(start >= STOP){
+                return 0;
+        }
+        /* nor if it is too far above or below to get there */
+        const int64_t DRIFT = (int64_t)abs(BALL->y_vel)*(STOP - start);
+        if(y + DRIFT + TALL <= TOP || y - DRIFT >= END){
+                return 0;
+        }
+
+        while(start < STOP){
+                int64_t span = STOP - start;
+                if(velocity){
+                        const int64_t WALL = (velocity > 0) ? (BOTTOM - y)/velocity : y/-velocity;
+                        if(WALL + 1 < span){
+                                span = WALL + 1;
+                        }
+                }
+
+                const struct field_sweep SWEEP = { .x = BALL->box.x + DIRECTION*start, .y = y, .direction = DIRECTION, .y_vel = velocity, .span = span, .scale = SPEED, .w = BALL->box.w, .h = BALL->box.h };
+                if(sweepBox(PADDLE, &SWEEP, hit)){
+                        hit->time += start;
+                        *y_vel = velocity;
+                        return 1;
+                }
+
+                start += span;
+                y = foldPosition(Y + BALL->y_vel*start, BOTTOM, &turned);
+                velocity = turned ? -BALL->y_vel : BALL->y_vel;
+
+                /* having turned within the unit, the ball may have gone
+                 * on through a face on the way back; it is put against it */
+                const int64_t X = BALL->box.x + DIRECTION*start;
+                if(X < PADDLE->x + PADDLE->w && X + BALL->box.w > PADDLE->x && y < END && y + TALL > TOP){
+                        const int64_t FACE = (velocity > 0) ? TOP - TALL : END;
+                        *hit = (struct field_hit){ .time = start, .y = (FACE > 0) ? FACE : 0, .vertical = 0 };
+                        *y_vel = velocity;
+                        return 1;
+                }
+        }
+
+        return 0;
+}
+
+/* Height of the ball, in the units of stepWorld(), after TIME more of
+ * them, turning it around for each wall it bounces off on the way */
+static int64_t sweepY(struct character *const ball, const int64_t Y, const int64_t TIME, const int64_t BOTTOM){
+        unsigned turned;
+        const int64_t FOLDED = foldPosition(Y + ball->y_vel*TIME, BOTTOM, &turned);
+        if(turned){
+                ball->y_vel *= -1;
+        }
+
+        return FOLDED;
+}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2014, William Breathitt Gray
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdint.h>
+
+struct field;
+
+#define WIDTH 640
+#define HEIGHT 480
+
+/* Default dimensions of the ball and paddles; see doc/media */
+#define BALL_WIDTH 18
+#define BALL_HEIGHT 18
+#define PADDLE_WIDTH 22
+#define PADDLE_HEIGHT 48
+
+/* Events reported by stepWorld() */
+#define WORLD_SCORE_PLAYER1 0x1u
+#define WORLD_SCORE_PLAYER2 0x2u
+#define WORLD_HIT_PLAYER1 0x4u
+#define WORLD_HIT_PLAYER2 0x8u
+#define WORLD_HIT_BRICK 0x10u
+#define WORLD_BREAK_BRICK 0x20u
+
+struct box{
+        int x;
+        int y;
+        int w;
+        int h;
+};
+
+struct character{
+        struct box box;
+        int x_vel;
+        int y_vel;
+};
+
+struct player{
+        struct character avatar;
+        unsigned score;
+};
+
+/* FIELD, if set, holds the bricks between the paddles; it is shared by
+ * every copy of the world rather than copied with it */
+struct world{
+        struct character ball;
+        struct player player1;
+        struct player player2;
+        uint64_t rng;
+        struct field *field;
+};
+
+#define WORLD_INITIALIZER { \
+        .ball = { .box = { .w = BALL_WIDTH, .h = BALL_HEIGHT }, .x_vel = 10 }, \
+        .player1.avatar.box = { .w = PADDLE_WIDTH, .h = PADDLE_HEIGHT }, \
+        .player2.avatar.box = { .w = PADDLE_WIDTH, .h = PADDLE_HEIGHT } \
+}
+
+int64_t foldPosition(const int64_t POSITION, const int64_t LIMIT, unsigned *const turned);
+uint64_t hashWorld(const struct world *const world);
+void initWorld(struct world *const world, const uint64_t SEED);
+uint64_t mixRandom(uint64_t *const state);
+void moveCharacter(struct character *const character);
+void paddleBounce(struct world *const world);
+void placePaddles(struct world *const world);
+void resetBall(struct world *const world);
+void resetWorld(struct world *const world);
+void seedWorld(struct world *const world, const uint64_t SEED);
+unsigned stepWorld(struct world *const world);
+uint32_t worldRandom(struct world *const world);
+
+#endif